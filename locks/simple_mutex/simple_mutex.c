@@ -76,10 +76,12 @@ int simple_mutex_lock(simple_mutex_t *mutex)
 	while (1)
 	{
 		// Another thread could have already released the lock
+		// Take it as _LOCKED_WAITERS: we can't know if others still sleep,
+		// and the woken thread is the only one left to carry the flag
 		if (val == _UNLOCKED)
 		{
 			if (atomic_compare_exchange_strong_explicit(
-				&mutex->word, &val, _LOCKED,
+				&mutex->word, &val, _LOCKED_WAITERS,
 				memory_order_acquire, memory_order_relaxed))
 			{
 				return 0;	// lock acquired
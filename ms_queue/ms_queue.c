@@ -1,6 +1,5 @@
 #include "ms_queue.h"
-#define __need_NULL
-#include <stddef.h>
+#include <stdlib.h>
 
 t_ms_queue *create_ms_queue()
 {
@@ -97,4 +96,12 @@ void *dequeue(t_ms_queue *q)
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+// oldest value without removing it, NULL if empty. dequeue frees the node
+// it unlinks, so only call this while no dequeue can run on q
+void *peek(t_ms_queue *q)
+{
+	t_node *head = atomic_load_explicit(&q->head, memory_order_acquire);
+	t_node *next = atomic_load_explicit(&head->next, memory_order_acquire);
+	return next ? next->data : NULL;
+}
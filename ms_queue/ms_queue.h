@@ -12,16 +12,34 @@ struct node
 	_Atomic(t_node *) next;
 };
 
+#ifdef TWO_LOCK_QUEUE
+# include "simple_mutex.h"
+# define MS_QUEUE_IMPL "two_lock"
+
+// Blocking baseline from the same paper: one lock per end,
+// enqueuers and dequeuers only meet on the dummy node's next
+typedef struct ms_queue
+{
+	simple_mutex_t	head_lock;
+	t_node	*head;
+	simple_mutex_t	tail_lock;
+	t_node	*tail;
+} t_ms_queue;
+#else
+# define MS_QUEUE_IMPL "lock_free"
+
 typedef struct ms_queue
 {
 	_Atomic(t_node *) head;
 	_Atomic(t_node *) tail;
 } t_ms_queue;
+#endif
 
 t_ms_queue	*create_ms_queue();
 void	destroy_ms_queue(t_ms_queue *q);
 
 bool	enqueue(t_ms_queue *q, void *data);	
 void	*dequeue(t_ms_queue *q);
+void	*peek(t_ms_queue *q);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "ms_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+// ==================== Configuration ====================
+
+#define SAMPLE_EVERY 16			// latency sampled once every N ops
+#define MAX_SAMPLES (1 << 20)	// per thread
+
+typedef enum { PIN_NONE, PIN_COMPACT, PIN_SPREAD } t_pin_policy;
+
+typedef struct s_bench_config
+{
+	int				producers;
+	int				consumers;
+	size_t			payload;
+	long			duration_ms;
+	t_pin_policy	pin;
+	const char		*queue;		// NULL = all
+} t_bench_config;
+
+// every message carries its origin so consumers can validate FIFO order
+typedef struct s_msg
+{
+	uint32_t		producer;
+	uint64_t		seq;
+	unsigned char	payload[];
+} t_msg;
+
+// ==================== Baseline queues ====================
+
+// Single pthread_mutex_t around a plain linked list
+typedef struct s_mutex_queue
+{
+	pthread_mutex_t	lock;
+	t_node			*head;
+	t_node			*tail;
+} t_mutex_queue;
+
+static void *mutex_create(void)
+{
+	t_mutex_queue *q = malloc(sizeof(t_mutex_queue));
+	if (!q) return NULL;
+	pthread_mutex_init(&q->lock, NULL);
+	q->head = NULL;
+	q->tail = NULL;
+	return q;
+}
+
+static void mutex_destroy(void *queue)
+{
+	t_mutex_queue *q = queue;
+	pthread_mutex_destroy(&q->lock);
+	free(q);
+}
+
+static bool mutex_enqueue(void *queue, void *data)
+{
+	t_mutex_queue *q = queue;
+	t_node *node = malloc(sizeof(t_node));
+	if (!node) return false;
+	node->data = data;
+	atomic_init(&node->next, NULL);
+	pthread_mutex_lock(&q->lock);
+	if (q->tail)
+		atomic_store_explicit(&q->tail->next, node, memory_order_relaxed);
+	else
+		q->head = node;
+	q->tail = node;
+	pthread_mutex_unlock(&q->lock);
+	return true;
+}
+
+static void *mutex_dequeue(void *queue)
+{
+	t_mutex_queue *q = queue;
+	pthread_mutex_lock(&q->lock);
+	t_node *node = q->head;
+	if (!node)
+		return (pthread_mutex_unlock(&q->lock), NULL);
+	q->head = atomic_load_explicit(&node->next, memory_order_relaxed);
+	if (!q->head)
+		q->tail = NULL;
+	pthread_mutex_unlock(&q->lock);
+	void *data = node->data;
+	free(node);
+	return data;
+}
+
+// Queue under test, lock-free or two-lock depending on the build
+static void *ms_create(void) { return create_ms_queue(); }
+static void ms_destroy(void *q) { destroy_ms_queue(q); }
+static bool ms_enqueue(void *q, void *data) { return enqueue(q, data); }
+static void *ms_dequeue(void *q) { return dequeue(q); }
+
+typedef struct s_bench_queue
+{
+	const char	*name;
+	void		*(*create)(void);
+	void		(*destroy)(void *q);
+	bool		(*enqueue)(void *q, void *data);
+	void		*(*dequeue)(void *q);
+} t_bench_queue;
+
+static const t_bench_queue g_queues[] = {
+	{"ms_queue", ms_create, ms_destroy, ms_enqueue, ms_dequeue},
+	{"pthread_mutex", mutex_create, mutex_destroy, mutex_enqueue, mutex_dequeue},
+};
+
+// ==================== Timing / pinning utilities ====================
+
+static inline uint64_t get_nanotime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int pick_cpu(const t_bench_config *cfg, int t)
+{
+	int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int nthreads = cfg->producers + cfg->consumers;
+	if (cfg->pin == PIN_NONE || ncpu <= 0)
+		return -1;
+	if (cfg->pin == PIN_SPREAD && nthreads < ncpu)
+		return (int)((long)t * ncpu / nthreads);
+	return t % ncpu;
+}
+
+static void pin_self(int cpu)
+{
+	if (cpu < 0) return;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+// ==================== Workers ====================
+
+typedef struct s_bench_thread
+{
+	pthread_t				thread;
+	const t_bench_queue		*impl;
+	void					*q;
+	const t_bench_config	*cfg;
+	int						id;
+	int						cpu;
+	atomic_int				*start;
+	atomic_int				*stop;
+	atomic_int				*producers_left;
+	uint64_t				ops;
+	uint64_t				*samples;
+	size_t					nsamples;
+	uint64_t				*last_seq;		// consumers only, one per producer
+	uint64_t				order_errors;
+} t_bench_thread;
+
+static inline void record(t_bench_thread *t, uint64_t ns)
+{
+	if (t->nsamples < MAX_SAMPLES)
+		t->samples[t->nsamples++] = ns;
+}
+
+static void *producer_worker(void *arg)
+{
+	t_bench_thread *t = arg;
+	size_t msg_size = sizeof(t_msg) + t->cfg->payload;
+	pin_self(t->cpu);
+	while (!atomic_load_explicit(t->start, memory_order_acquire))
+		sched_yield();
+	while (!atomic_load_explicit(t->stop, memory_order_relaxed))
+	{
+		t_msg *msg = malloc(msg_size);
+		if (!msg) break;
+		msg->producer = t->id;
+		msg->seq = t->ops + 1;
+		memset(msg->payload, (int)msg->seq, t->cfg->payload);
+		if (t->ops % SAMPLE_EVERY)
+		{
+			while (!t->impl->enqueue(t->q, msg))
+				sched_yield();
+		}
+		else
+		{
+			uint64_t t0 = get_nanotime();
+			while (!t->impl->enqueue(t->q, msg))
+				sched_yield();
+			record(t, get_nanotime() - t0);
+		}
+		t->ops++;
+	}
+	atomic_fetch_sub_explicit(t->producers_left, 1, memory_order_release);
+	return NULL;
+}
+
+static void *consumer_worker(void *arg)
+{
+	t_bench_thread *t = arg;
+	pin_self(t->cpu);
+	while (!atomic_load_explicit(t->start, memory_order_acquire))
+		sched_yield();
+	while (1)
+	{
+		// read before dequeue: if no producer is left, NULL means drained
+		int left = atomic_load_explicit(t->producers_left, memory_order_acquire);
+		t_msg *msg;
+		if (t->ops % SAMPLE_EVERY)
+			msg = t->impl->dequeue(t->q);
+		else
+		{
+			uint64_t t0 = get_nanotime();
+			msg = t->impl->dequeue(t->q);
+			if (msg)
+				record(t, get_nanotime() - t0);
+		}
+		if (!msg)
+		{
+			if (!left) break;
+			sched_yield();
+			continue;
+		}
+		if (msg->seq <= t->last_seq[msg->producer])
+			t->order_errors++;
+		t->last_seq[msg->producer] = msg->seq;
+		if (t->cfg->payload && msg->payload[t->cfg->payload - 1] != (unsigned char)msg->seq)
+			t->order_errors++;
+		free(msg);
+		t->ops++;
+	}
+	return NULL;
+}
+
+// ==================== Runner ====================
+
+static void print_percentiles(const char *label, t_bench_thread *threads, int n)
+{
+	size_t total = 0;
+	for (int i = 0; i < n; i++)
+		total += threads[i].nsamples;
+	if (!total)
+	{
+		printf("  %-8s latency: no samples\n", label);
+		return;
+	}
+	uint64_t *all = malloc(total * sizeof(uint64_t));
+	if (!all) return;
+	size_t k = 0;
+	for (int i = 0; i < n; i++)
+	{
+		memcpy(all + k, threads[i].samples, threads[i].nsamples * sizeof(uint64_t));
+		k += threads[i].nsamples;
+	}
+	qsort(all, total, sizeof(uint64_t), cmp_u64);
+	printf("  %-8s latency (ns): p50 %6lu | p90 %6lu | p99 %7lu | p99.9 %8lu | max %9lu\n",
+		label,
+		(unsigned long)all[total * 50 / 100],
+		(unsigned long)all[total * 90 / 100],
+		(unsigned long)all[total * 99 / 100],
+		(unsigned long)all[total * 999 / 1000],
+		(unsigned long)all[total - 1]);
+	free(all);
+}
+
+static int run_bench(const t_bench_queue *impl, const t_bench_config *cfg)
+{
+	int np = cfg->producers, nc = cfg->consumers;
+	t_bench_thread *threads = calloc(np + nc, sizeof(t_bench_thread));
+	void *q = impl->create();
+	if (!threads || !q)
+		return (free(threads), fprintf(stderr, "%s: allocation failed\n", impl->name), 0);
+
+	atomic_int start = 0, stop = 0, producers_left = np;
+	for (int i = 0; i < np + nc; i++)
+	{
+		t_bench_thread *t = &threads[i];
+		t->impl = impl;
+		t->q = q;
+		t->cfg = cfg;
+		t->id = i < np ? i : i - np;
+		t->cpu = pick_cpu(cfg, i);
+		t->start = &start;
+		t->stop = &stop;
+		t->producers_left = &producers_left;
+		t->samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+		if (i >= np)
+			t->last_seq = calloc(np, sizeof(uint64_t));
+		pthread_create(&t->thread, NULL, i < np ? producer_worker : consumer_worker, t);
+	}
+
+	usleep(10000);	// let threads reach the start line
+	uint64_t t0 = get_nanotime();
+	atomic_store_explicit(&start, 1, memory_order_release);
+	usleep(cfg->duration_ms * 1000);
+	atomic_store_explicit(&stop, 1, memory_order_relaxed);
+	for (int i = 0; i < np + nc; i++)
+		pthread_join(threads[i].thread, NULL);
+	double elapsed = (get_nanotime() - t0) / 1e9;
+
+	uint64_t enq = 0, deq = 0, errors = 0;
+	for (int i = 0; i < np; i++)
+		enq += threads[i].ops;
+	for (int i = np; i < np + nc; i++)
+	{
+		deq += threads[i].ops;
+		errors += threads[i].order_errors;
+	}
+
+	printf("\n[%s%s] %d producers / %d consumers, %zu B payload\n",
+		impl->name, impl->create == ms_create ? " " MS_QUEUE_IMPL : "",
+		np, nc, cfg->payload);
+	printf("  Throughput: %.2f M items/s (%lu items in %.2f s)\n",
+		deq / elapsed / 1e6, (unsigned long)deq, elapsed);
+	print_percentiles("enqueue", threads, np);
+	print_percentiles("dequeue", threads + np, nc);
+	int ok = (enq == deq && errors == 0);
+	printf("  Validation: %s (enqueued %lu, dequeued %lu, %lu FIFO violations)\n",
+		ok ? "OK" : "FAILED", (unsigned long)enq, (unsigned long)deq, (unsigned long)errors);
+
+	for (int i = 0; i < np + nc; i++)
+	{
+		free(threads[i].samples);
+		free(threads[i].last_seq);
+	}
+	free(threads);
+	impl->destroy(q);
+	return ok;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-p producers] [-c consumers] [-s payload_bytes]\n"
+		"       [-d duration_ms] [-a none|compact|spread]\n"
+		"       [-q ms_queue|pthread_mutex]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	t_bench_config cfg = {2, 2, 64, 2000, PIN_NONE, NULL};
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:c:s:d:a:q:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p': cfg.producers = atoi(optarg); break;
+			case 'c': cfg.consumers = atoi(optarg); break;
+			case 's': cfg.payload = strtoul(optarg, NULL, 10); break;
+			case 'd': cfg.duration_ms = atol(optarg); break;
+			case 'a':
+				if (!strcmp(optarg, "none")) cfg.pin = PIN_NONE;
+				else if (!strcmp(optarg, "compact")) cfg.pin = PIN_COMPACT;
+				else if (!strcmp(optarg, "spread")) cfg.pin = PIN_SPREAD;
+				else return (usage(argv[0]), 1);
+				break;
+			case 'q': cfg.queue = optarg; break;
+			default: return (usage(argv[0]), 1);
+		}
+	}
+	if (cfg.producers < 1 || cfg.consumers < 1 || cfg.duration_ms < 1)
+		return (usage(argv[0]), 1);
+
+	printf("=========================================\n");
+	printf("MPMC QUEUE BENCHMARK\n");
+	printf("=========================================\n");
+	printf("System: %d CPU cores available, pinning: %s\n",
+		(int)sysconf(_SC_NPROCESSORS_ONLN),
+		cfg.pin == PIN_NONE ? "none" : cfg.pin == PIN_COMPACT ? "compact" : "spread");
+
+	int ok = 1, ran = 0;
+	for (size_t i = 0; i < sizeof(g_queues) / sizeof(g_queues[0]); i++)
+	{
+		if (cfg.queue && strcmp(cfg.queue, g_queues[i].name))
+			continue;
+		ok &= run_bench(&g_queues[i], &cfg);
+		ran++;
+	}
+	if (!ran)
+		return (usage(argv[0]), 1);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+#include "ms_queue.h"
+#include "multi_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define THREADS 4
+#define ITEMS_PER_THREAD 100000
+
+void test_create_destroy(void)
+{
+	printf("test_create_destroy: ");
+	t_ms_queue *q = create_ms_queue();
+	assert(q != NULL);
+	void *v = dequeue(q);
+	assert(v == NULL);
+	destroy_ms_queue(q);
+	printf("✓\n");
+}
+
+void test_fifo_order(void)
+{
+	printf("test_fifo_order: ");
+	t_ms_queue *q = create_ms_queue();
+	bool ok;
+	void *v;
+	for (uintptr_t i = 1; i <= 1000; i++)
+	{
+		ok = enqueue(q, (void *)i);
+		assert(ok);
+	}
+	for (uintptr_t i = 1; i <= 1000; i++)
+	{
+		v = dequeue(q);
+		assert(v == (void *)i);
+	}
+	v = dequeue(q);
+	assert(v == NULL);
+	destroy_ms_queue(q);
+	printf("✓\n");
+}
+
+void test_interleaved(void)
+{
+	printf("test_interleaved: ");
+	t_ms_queue *q = create_ms_queue();
+	uintptr_t next_in = 1, next_out = 1;
+	bool ok;
+	void *v;
+	for (int round = 0; round < 100; round++)
+	{
+		for (int i = 0; i < 7; i++)
+		{
+			ok = enqueue(q, (void *)next_in++);
+			assert(ok);
+		}
+		for (int i = 0; i < 5; i++)
+		{
+			v = dequeue(q);
+			assert(v == (void *)next_out);
+			next_out++;
+		}
+	}
+	while (next_out < next_in)
+	{
+		v = dequeue(q);
+		assert(v == (void *)next_out);
+		next_out++;
+	}
+	v = dequeue(q);
+	assert(v == NULL);
+	destroy_ms_queue(q);
+	printf("✓\n");
+}
+
+typedef struct
+{
+	void		*q;		// t_ms_queue or t_multi_queue
+	int			id;
+	long		sum;
+} t_worker_args;
+
+// every value is (id << 32 | seq), seq starting at 1 so it's never NULL
+static void *producer(void *arg)
+{
+	t_worker_args *a = arg;
+	for (uintptr_t i = 1; i <= ITEMS_PER_THREAD; i++)
+		while (!enqueue(a->q, (void *)(((uintptr_t)a->id << 32) | i)))
+			;
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	t_worker_args *a = arg;
+	uintptr_t last[THREADS] = {0};
+	long got = 0;
+	while (got < ITEMS_PER_THREAD)
+	{
+		uintptr_t v = (uintptr_t)dequeue(a->q);
+		if (!v)
+		{
+			sched_yield();
+			continue;
+		}
+		uintptr_t id = v >> 32, seq = v & 0xFFFFFFFF;
+		assert(id < THREADS);
+		assert(seq > last[id]);		// per-producer FIFO
+		last[id] = seq;
+		a->sum += seq;
+		got++;
+	}
+	return NULL;
+}
+
+void test_concurrent_mpmc(void)
+{
+	printf("test_concurrent_mpmc: ");
+	t_ms_queue *q = create_ms_queue();
+	pthread_t prod[THREADS], cons[THREADS];
+	t_worker_args pargs[THREADS], cargs[THREADS];
+
+	for (int i = 0; i < THREADS; i++)
+	{
+		pargs[i] = (t_worker_args){q, i, 0};
+		cargs[i] = (t_worker_args){q, i, 0};
+		pthread_create(&cons[i], NULL, consumer, &cargs[i]);
+		pthread_create(&prod[i], NULL, producer, &pargs[i]);
+	}
+	long total = 0;
+	for (int i = 0; i < THREADS; i++)
+	{
+		pthread_join(prod[i], NULL);
+		pthread_join(cons[i], NULL);
+		total += cargs[i].sum;
+	}
+	long expected = (long)THREADS * ITEMS_PER_THREAD * (ITEMS_PER_THREAD + 1) / 2;
+	assert(total == expected);
+	void *v = dequeue(q);
+	assert(v == NULL);
+	destroy_ms_queue(q);
+	printf("✓\n");
+}
+
+void test_multi_queue_drain(void)
+{
+	printf("test_multi_queue_drain: ");
+	int policies[2] = {MQ_RANDOM, MQ_RANDOM | MQ_BY_SIZE};
+	for (int p = 0; p < 2; p++)
+	{
+		t_multi_queue *mq = create_multi_queue(8, policies[p]);
+		assert(mq != NULL);
+		void *empty = multi_dequeue(mq);
+		assert(empty == NULL);
+		static char seen[10001];
+		memset(seen, 0, sizeof(seen));
+		for (uintptr_t i = 1; i <= 10000; i++)
+		{
+			bool ok = multi_enqueue(mq, (void *)i);
+			assert(ok);
+		}
+		for (int i = 0; i < 10000; i++)
+		{
+			uintptr_t v = (uintptr_t)multi_dequeue(mq);
+			assert(v >= 1 && v <= 10000 && !seen[v]);
+			seen[v] = 1;
+		}
+		empty = multi_dequeue(mq);
+		assert(empty == NULL);	// full scan before reporting empty
+		destroy_multi_queue(mq);
+	}
+	printf("✓\n");
+}
+
+static void *multi_producer(void *arg)
+{
+	t_worker_args *a = arg;
+	t_multi_queue *mq = a->q;
+	for (uintptr_t i = 1; i <= ITEMS_PER_THREAD; i++)
+		while (!multi_enqueue(mq, (void *)(((uintptr_t)a->id << 32) | i)))
+			;
+	return NULL;
+}
+
+// per-thread shards keep each producer's items in order
+void test_multi_queue_per_thread_order(void)
+{
+	printf("test_multi_queue_per_thread_order: ");
+	t_multi_queue *mq = create_multi_queue(THREADS, MQ_PER_THREAD);
+	pthread_t prod[THREADS];
+	t_worker_args pargs[THREADS];
+	for (int i = 0; i < THREADS; i++)
+	{
+		pargs[i] = (t_worker_args){mq, i, 0};
+		pthread_create(&prod[i], NULL, multi_producer, &pargs[i]);
+	}
+	uintptr_t last[THREADS] = {0};
+	long got = 0;
+	while (got < (long)THREADS * ITEMS_PER_THREAD)
+	{
+		uintptr_t v = (uintptr_t)multi_dequeue(mq);
+		if (!v)
+		{
+			sched_yield();
+			continue;
+		}
+		uintptr_t id = v >> 32, seq = v & 0xFFFFFFFF;
+		assert(id < THREADS && seq > last[id]);
+		last[id] = seq;
+		got++;
+	}
+	for (int i = 0; i < THREADS; i++)
+		pthread_join(prod[i], NULL);
+	void *empty = multi_dequeue(mq);
+	assert(empty == NULL);
+	destroy_multi_queue(mq);
+	printf("✓\n");
+}
+
+// relaxed across shards, so only check that nothing is lost or duplicated
+static void *multi_consumer(void *arg)
+{
+	t_worker_args *a = arg;
+	t_multi_queue *mq = a->q;
+	long got = 0;
+	while (got < ITEMS_PER_THREAD)
+	{
+		uintptr_t v = (uintptr_t)multi_dequeue(mq);
+		if (!v)
+		{
+			sched_yield();
+			continue;
+		}
+		assert((v >> 32) < THREADS);
+		a->sum += v & 0xFFFFFFFF;
+		got++;
+	}
+	return NULL;
+}
+
+void test_multi_queue_mpmc(void)
+{
+	printf("test_multi_queue_mpmc: ");
+	t_multi_queue *mq = create_multi_queue(THREADS * 2, MQ_RANDOM);
+	pthread_t prod[THREADS], cons[THREADS];
+	t_worker_args pargs[THREADS], cargs[THREADS];
+
+	for (int i = 0; i < THREADS; i++)
+	{
+		pargs[i] = (t_worker_args){mq, i, 0};
+		cargs[i] = (t_worker_args){mq, i, 0};
+		pthread_create(&cons[i], NULL, multi_consumer, &cargs[i]);
+		pthread_create(&prod[i], NULL, multi_producer, &pargs[i]);
+	}
+	long total = 0;
+	for (int i = 0; i < THREADS; i++)
+	{
+		pthread_join(prod[i], NULL);
+		pthread_join(cons[i], NULL);
+		total += cargs[i].sum;
+	}
+	long expected = (long)THREADS * ITEMS_PER_THREAD * (ITEMS_PER_THREAD + 1) / 2;
+	assert(total == expected);
+	void *empty = multi_dequeue(mq);
+	assert(empty == NULL);
+	destroy_multi_queue(mq);
+	printf("✓\n");
+}
+
+int main(void)
+{
+	printf("Running MS Queue Tests\n");
+	printf("======================\n");
+	test_create_destroy();
+	test_fifo_order();
+	test_interleaved();
+	test_concurrent_mpmc();
+	test_multi_queue_drain();
+	test_multi_queue_per_thread_order();
+	test_multi_queue_mpmc();
+	printf("\n✅ ALL TESTS PASSED\n");
+	return 0;
+}
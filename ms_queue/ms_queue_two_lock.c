@@ -0,0 +1,69 @@
+#include "ms_queue.h"
+#include <stdlib.h>
+
+// build with -DTWO_LOCK_QUEUE, same API as the lock-free version
+t_ms_queue *create_ms_queue()
+{
+	// locks are cache-line aligned
+	t_ms_queue *queue = aligned_alloc(64, sizeof(t_ms_queue));
+	if (!queue) return NULL;
+	t_node	*dummy = malloc(sizeof(t_node));
+	if (!dummy) return (free(queue), NULL);
+	dummy->data = NULL;
+	atomic_init(&dummy->next, NULL);
+	queue->head = dummy;
+	queue->tail = dummy;
+	simple_mutex_init(&queue->head_lock);
+	simple_mutex_init(&queue->tail_lock);
+	return queue;
+}
+
+// same contract as the lock-free version: empty it first
+void destroy_ms_queue(t_ms_queue *q)
+{
+	if (q)
+	{
+		simple_mutex_destroy(&q->head_lock);
+		simple_mutex_destroy(&q->tail_lock);
+		if (q->head) free(q->head);
+		free(q);
+	}
+}
+
+bool enqueue(t_ms_queue *q, void *data)
+{
+	t_node	*new_node = malloc(sizeof(t_node));
+	if (!new_node) return false;
+	new_node->data = data;
+	atomic_init(&new_node->next, NULL);
+	simple_mutex_lock(&q->tail_lock);
+	// a dequeuer may be reading next of the dummy right now
+	atomic_store_explicit(&q->tail->next, new_node, memory_order_release);
+	q->tail = new_node;
+	simple_mutex_unlock(&q->tail_lock);
+	return true;
+}
+
+void *dequeue(t_ms_queue *q)
+{
+	simple_mutex_lock(&q->head_lock);
+	t_node *head = q->head;
+	t_node *next = atomic_load_explicit(&head->next, memory_order_acquire);
+	if (!next)	// empty
+		return (simple_mutex_unlock(&q->head_lock), NULL);
+	void *value = next->data;
+	q->head = next;		// next becomes the new dummy
+	simple_mutex_unlock(&q->head_lock);
+	// nobody else can reach the old dummy anymore
+	free(head);
+	return value;
+}
+
+void *peek(t_ms_queue *q)
+{
+	simple_mutex_lock(&q->head_lock);
+	t_node *next = atomic_load_explicit(&q->head->next, memory_order_acquire);
+	void *value = next ? next->data : NULL;
+	simple_mutex_unlock(&q->head_lock);
+	return value;
+}
@@ -0,0 +1,228 @@
+#include "multi_queue.h"
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+
+// what the shards hold unless MQ_BY_SIZE
+typedef struct mq_item
+{
+	void		*data;
+	uint64_t	stamp;
+} t_mq_item;
+
+static atomic_size_t	g_next_shard = 0;
+static _Thread_local uint64_t	tl_rng = 0;
+static _Thread_local size_t	tl_shard = SIZE_MAX;
+
+// xorshift64*, seeded lazily from a per-thread address
+static inline uint64_t rng_next(void)
+{
+	if (!tl_rng)
+		tl_rng = ((uintptr_t)&tl_rng * 0x9E3779B97F4A7C15ULL) | 1;
+	tl_rng ^= tl_rng >> 12;
+	tl_rng ^= tl_rng << 25;
+	tl_rng ^= tl_rng >> 27;
+	return tl_rng * 0x2545F4914F6CDD1DULL;
+}
+
+// enqueue time, only compared across shards so cheap beats exact
+static inline uint64_t now_stamp(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// nshards=0 is bumped to 1 (plain ms_queue with extra steps)
+t_multi_queue *create_multi_queue(size_t nshards, int policy)
+{
+	if (!nshards) nshards = 1;
+	t_multi_queue *mq = malloc(sizeof(t_multi_queue));
+	if (!mq) return NULL;
+	mq->shards = aligned_alloc(64, nshards * sizeof(t_mq_shard));
+	if (!mq->shards) return (free(mq), NULL);
+	mq->nshards = 0;	// to use destroy_multi_queue safely
+	mq->policy = policy;
+	for (size_t i = 0; i < nshards; i++)
+	{
+		mq->shards[i].queue = create_ms_queue();
+		if (!mq->shards[i].queue)
+			return (destroy_multi_queue(mq), NULL);
+		atomic_init(&mq->shards[i].top, MQ_EMPTY);
+		atomic_flag_clear(&mq->shards[i].busy);
+		atomic_init(&mq->shards[i].size, 0);
+		mq->nshards++;
+	}
+	return mq;
+}
+
+// same contract as destroy_ms_queue: empty it first
+void destroy_multi_queue(t_multi_queue *mq)
+{
+	if (!mq) return;
+	for (size_t i = 0; i < mq->nshards; i++)
+		destroy_ms_queue(mq->shards[i].queue);
+	free(mq->shards);
+	free(mq);
+}
+
+bool multi_enqueue(t_multi_queue *mq, void *data)
+{
+	size_t i;
+	if (mq->policy & MQ_PER_THREAD)
+	{
+		// round-robin assignment on first use, sticky afterwards
+		if (tl_shard == SIZE_MAX)
+			tl_shard = atomic_fetch_add_explicit(&g_next_shard, 1, memory_order_relaxed);
+		i = tl_shard % mq->nshards;
+	}
+	else
+		i = rng_next() % mq->nshards;
+	t_mq_shard *s = &mq->shards[i];
+	if (mq->policy & MQ_BY_SIZE)
+	{
+		if (!enqueue(s->queue, data))
+			return false;
+		atomic_fetch_add_explicit(&s->size, 1, memory_order_relaxed);
+		return true;
+	}
+	t_mq_item *item = malloc(sizeof(t_mq_item));
+	if (!item) return false;
+	item->data = data;
+	item->stamp = now_stamp();
+	if (!enqueue(s->queue, item))
+		return (free(item), false);
+	// shard looked empty: we're its oldest item, unless a dequeuer
+	// or an earlier enqueue already published one
+	uint64_t empty = MQ_EMPTY;
+	atomic_compare_exchange_strong(&s->top, &empty, item->stamp);
+	return true;
+}
+
+static inline bool shard_trylock(t_mq_shard *s)
+{
+	return !atomic_flag_test_and_set_explicit(&s->busy, memory_order_acquire);
+}
+
+static inline void shard_lock(t_mq_shard *s)
+{
+	while (!shard_trylock(s))
+		sched_yield();
+}
+
+static inline void shard_unlock(t_mq_shard *s)
+{
+	atomic_flag_clear_explicit(&s->busy, memory_order_release);
+}
+
+// lock held: nobody else frees items of this shard, so peeking is safe
+static void shard_publish_top(t_mq_shard *s)
+{
+	t_mq_item *next = peek(s->queue);
+	if (!next)
+	{
+		atomic_store(&s->top, MQ_EMPTY);
+		// an enqueue that linked after our peek either sees MQ_EMPTY
+		// and publishes itself, or shows up here
+		if (!(next = peek(s->queue)))
+			return;
+	}
+	atomic_store(&s->top, next->stamp);
+}
+
+// lock held
+static void *shard_pop(t_mq_shard *s)
+{
+	t_mq_item *item = dequeue(s->queue);
+	shard_publish_top(s);
+	if (!item)
+		return NULL;
+	void *data = item->data;
+	free(item);
+	return data;
+}
+
+static inline void *shard_dequeue(t_mq_shard *s)
+{
+	void *data = dequeue(s->queue);
+	if (data)
+		atomic_fetch_sub_explicit(&s->size, 1, memory_order_relaxed);
+	return data;
+}
+
+static void *dequeue_by_size(t_multi_queue *mq)
+{
+	size_t n = mq->nshards;
+	uint64_t r = rng_next();
+	size_t i = r % n;
+	void *data;
+
+	if (n > 1)
+	{
+		size_t j = (i + 1 + (r >> 32) % (n - 1)) % n;	// j != i
+		long si = atomic_load_explicit(&mq->shards[i].size, memory_order_relaxed);
+		long sj = atomic_load_explicit(&mq->shards[j].size, memory_order_relaxed);
+		if (sj > si)
+		{
+			size_t tmp = i;
+			i = j;
+			j = tmp;
+		}
+		if ((data = shard_dequeue(&mq->shards[i])))
+			return data;
+		if ((data = shard_dequeue(&mq->shards[j])))
+			return data;
+	}
+	for (size_t k = 0; k < n; k++)
+		if ((data = shard_dequeue(&mq->shards[(i + k) % n])))
+			return data;
+	return NULL;
+}
+
+// NULL only if every shard looked empty during the final scan
+void *multi_dequeue(t_multi_queue *mq)
+{
+	if (mq->policy & MQ_BY_SIZE)
+		return dequeue_by_size(mq);
+
+	size_t n = mq->nshards;
+	size_t i = 0;
+	void *data;
+
+	// a busy or stale pick just costs another sample
+	for (size_t tries = 0; n > 1 && tries < n; tries++)
+	{
+		uint64_t r = rng_next();
+		i = r % n;
+		size_t j = (i + 1 + (r >> 32) % (n - 1)) % n;	// j != i
+		uint64_t ti = atomic_load_explicit(&mq->shards[i].top, memory_order_relaxed);
+		uint64_t tj = atomic_load_explicit(&mq->shards[j].top, memory_order_relaxed);
+		if (tj < ti)
+		{
+			i = j;
+			ti = tj;
+		}
+		if (ti == MQ_EMPTY)
+			break;
+		if (!shard_trylock(&mq->shards[i]))
+			continue;
+		data = shard_pop(&mq->shards[i]);
+		shard_unlock(&mq->shards[i]);
+		if (data)
+			return data;
+	}
+	for (size_t k = 0; k < n; k++)
+	{
+		t_mq_shard *s = &mq->shards[(i + k) % n];
+		shard_lock(s);
+		data = shard_pop(s);
+		shard_unlock(s);
+		if (data)
+			return data;
+	}
+	return NULL;
+}
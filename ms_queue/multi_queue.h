@@ -0,0 +1,65 @@
+#ifndef MULTI_QUEUE_H
+#define MULTI_QUEUE_H
+
+#include "ms_queue.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
+
+/*
+ * Relaxed-FIFO multi-queue: an array of t_ms_queue shards.
+ * Enqueue picks a shard (random, or a fixed one per thread) and
+ * stamps the item with its enqueue time. Every shard advertises the
+ * stamp of its oldest item; dequeue samples two shards and pops from
+ * the one whose oldest item is older (power of two choices), falling
+ * back to a full scan before reporting empty. Dequeuers take a
+ * per-shard try-lock so they can read the next item's stamp.
+ *
+ * Ordering guarantees:
+ * - each shard is FIFO, so with MQ_PER_THREAD every producer's
+ *   items come out in the order it enqueued them;
+ * - across shards order is relaxed. The rank error of a dequeue is
+ *   the number of older items still queued when it is returned.
+ *   With MQ_RANDOM, sequential two-choice on the oldest items has an
+ *   expected rank error of O(nshards), O(nshards log nshards) w.h.p.,
+ *   independent of queue depth (Alistarh et al., "The Power of Choice
+ *   in Priority Scheduling", PODC 2017). Concurrent dequeuers and
+ *   stale stamps add to it; bench_multi_queue measures it
+ *   (make bench-multi).
+ *   MQ_PER_THREAD voids the bound: a slow producer's shard holds
+ *   only its items, whatever their age.
+ *
+ * MQ_BY_SIZE (or'ed into the policy) drops the stamps and the
+ * locks, and pops from the longer of the two shards instead. That
+ * balances the shards but not their ages, so there is no bound: the
+ * measured rank error grows with queue depth.
+ */
+
+# define MQ_RANDOM		0
+# define MQ_PER_THREAD	1
+# define MQ_BY_SIZE		2
+
+# define MQ_EMPTY		UINT64_MAX
+
+typedef struct mq_shard
+{
+	alignas(64) t_ms_queue	*queue;
+	_Atomic uint64_t	top;	// oldest item's stamp, MQ_EMPTY if none
+	atomic_flag	busy;		// held by the dequeuer
+	atomic_long	size;		// approximate, MQ_BY_SIZE only
+} t_mq_shard;
+
+typedef struct multi_queue
+{
+	t_mq_shard	*shards;
+	size_t	nshards;
+	int		policy;
+} t_multi_queue;
+
+t_multi_queue	*create_multi_queue(size_t nshards, int policy);
+void	destroy_multi_queue(t_multi_queue *mq);
+
+bool	multi_enqueue(t_multi_queue *mq, void *data);
+void	*multi_dequeue(t_multi_queue *mq);
+
+#endif
@@ -0,0 +1,252 @@
+#include "multi_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#define PREFILL 1024
+
+typedef struct s_bench_config
+{
+	int		shards_per_thread;
+	int		max_threads;
+	long	duration_ms;
+	size_t	rank_ops;
+} t_bench_config;
+
+static inline uint64_t get_nanotime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ==================== Scaling ====================
+
+// NULL mq = single ms_queue
+typedef struct s_pair_args
+{
+	t_ms_queue		*q;
+	t_multi_queue	*mq;
+	atomic_int		*start;
+	atomic_int		*stop;
+	long			ops;
+} t_pair_args;
+
+// enqueue/dequeue pairs keep the queue at a steady size
+static void *pair_worker(void *arg)
+{
+	t_pair_args *a = arg;
+	uintptr_t v = 1;
+	while (!atomic_load_explicit(a->start, memory_order_acquire))
+		sched_yield();
+	while (!atomic_load_explicit(a->stop, memory_order_relaxed))
+	{
+		if (a->mq)
+		{
+			multi_enqueue(a->mq, (void *)v++);
+			multi_dequeue(a->mq);
+		}
+		else
+		{
+			enqueue(a->q, (void *)v++);
+			dequeue(a->q);
+		}
+		a->ops++;
+	}
+	return NULL;
+}
+
+static double run_pairs(int nthreads, t_ms_queue *q, t_multi_queue *mq, long duration_ms)
+{
+	pthread_t threads[nthreads];
+	t_pair_args args[nthreads];
+	atomic_int start = 0, stop = 0;
+
+	for (uintptr_t i = 1; i <= PREFILL; i++)
+		mq ? multi_enqueue(mq, (void *)i) : enqueue(q, (void *)i);
+	for (int i = 0; i < nthreads; i++)
+	{
+		args[i] = (t_pair_args){q, mq, &start, &stop, 0};
+		pthread_create(&threads[i], NULL, pair_worker, &args[i]);
+	}
+	usleep(10000);
+	uint64_t t0 = get_nanotime();
+	atomic_store_explicit(&start, 1, memory_order_release);
+	usleep(duration_ms * 1000);
+	atomic_store_explicit(&stop, 1, memory_order_relaxed);
+	long total = 0;
+	for (int i = 0; i < nthreads; i++)
+	{
+		pthread_join(threads[i], NULL);
+		total += args[i].ops;
+	}
+	double elapsed = (get_nanotime() - t0) / 1e9;
+	while (mq ? multi_dequeue(mq) : dequeue(q))
+		;
+	return total / elapsed / 1e6;
+}
+
+static void benchmark_scaling(const t_bench_config *cfg)
+{
+	printf("\n=========================================\n");
+	printf("BENCHMARK 1: Scaling (enqueue+dequeue pairs, %ld ms, %d shards/thread)\n",
+		cfg->duration_ms, cfg->shards_per_thread);
+	printf("=========================================\n\n");
+	printf("Threads | ms_queue (M pairs/s) | multi random (M pairs/s) | multi per-thread (M pairs/s) | multi by size (M pairs/s)\n");
+	printf("--------|----------------------|--------------------------|------------------------------|--------------------------\n");
+
+	for (int t = 1; t <= cfg->max_threads; t *= 2)
+	{
+		t_ms_queue *q = create_ms_queue();
+		double single = run_pairs(t, q, NULL, cfg->duration_ms);
+		destroy_ms_queue(q);
+
+		double multi[3];
+		int policies[3] = {MQ_RANDOM, MQ_PER_THREAD, MQ_RANDOM | MQ_BY_SIZE};
+		for (int p = 0; p < 3; p++)
+		{
+			t_multi_queue *mq = create_multi_queue((size_t)t * cfg->shards_per_thread, policies[p]);
+			multi[p] = run_pairs(t, NULL, mq, cfg->duration_ms);
+			destroy_multi_queue(mq);
+		}
+		printf("%7d | %20.2f | %24.2f | %28.2f | %24.2f\n", t, single, multi[0], multi[1], multi[2]);
+	}
+}
+
+// ==================== Rank error ====================
+
+// Fenwick tree over sequence numbers still in the queue
+typedef struct s_fenwick
+{
+	long	*tree;
+	size_t	n;
+} t_fenwick;
+
+static void fenwick_add(t_fenwick *f, size_t i, long delta)
+{
+	for (i++; i <= f->n; i += i & -i)
+		f->tree[i] += delta;
+}
+
+// number of present items with seq < i
+static long fenwick_prefix(t_fenwick *f, size_t i)
+{
+	long sum = 0;
+	for (; i > 0; i -= i & -i)
+		sum += f->tree[i];
+	return sum;
+}
+
+static int cmp_long(const void *a, const void *b)
+{
+	long x = *(const long *)a, y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Single-threaded steady state: the queue holds `depth` items, each step
+ * enqueues the next sequence number and dequeues one. The rank error of a
+ * dequeue is how many older items were still queued. Exact, but it only
+ * captures the algorithmic relaxation, not interleavings.
+ */
+static void measure_rank_error(const char *label, t_ms_queue *q, t_multi_queue *mq,
+	size_t depth, size_t ops)
+{
+	t_fenwick f = {calloc(depth + ops + 1, sizeof(long)), depth + ops};
+	long *ranks = malloc(ops * sizeof(long));
+	if (!f.tree || !ranks)
+		return (free(f.tree), free(ranks));
+
+	uintptr_t seq = 0;
+	for (; seq < depth; seq++)
+	{
+		mq ? multi_enqueue(mq, (void *)(seq + 1)) : enqueue(q, (void *)(seq + 1));
+		fenwick_add(&f, seq, 1);
+	}
+	double sum = 0;
+	for (size_t i = 0; i < ops; i++, seq++)
+	{
+		mq ? multi_enqueue(mq, (void *)(seq + 1)) : enqueue(q, (void *)(seq + 1));
+		fenwick_add(&f, seq, 1);
+		uintptr_t got = (uintptr_t)(mq ? multi_dequeue(mq) : dequeue(q)) - 1;
+		ranks[i] = fenwick_prefix(&f, got);
+		fenwick_add(&f, got, -1);
+		sum += ranks[i];
+	}
+	while (mq ? multi_dequeue(mq) : dequeue(q))
+		;
+	qsort(ranks, ops, sizeof(long), cmp_long);
+	printf("%-22s | %10.2f | %8ld | %8ld | %8ld\n", label, sum / ops,
+		ranks[ops / 2], ranks[ops * 99 / 100], ranks[ops - 1]);
+	free(ranks);
+	free(f.tree);
+}
+
+static void benchmark_rank_error(const t_bench_config *cfg)
+{
+	const size_t depth = 10000;
+	printf("\n=========================================\n");
+	printf("BENCHMARK 2: Rank error (queue depth %zu, %zu ops)\n", depth, cfg->rank_ops);
+	printf("=========================================\n\n");
+	printf("Queue                  | mean rank  | p50      | p99      | max\n");
+	printf("-----------------------|------------|----------|----------|---------\n");
+
+	t_ms_queue *q = create_ms_queue();
+	measure_rank_error("ms_queue", q, NULL, depth, cfg->rank_ops);
+	destroy_ms_queue(q);
+
+	size_t shard_counts[] = {2, 4, 8, 16, 64};
+	for (size_t i = 0; i < sizeof(shard_counts) / sizeof(shard_counts[0]); i++)
+	{
+		char label[32];
+		snprintf(label, sizeof(label), "multi %zu shards", shard_counts[i]);
+		t_multi_queue *mq = create_multi_queue(shard_counts[i], MQ_RANDOM);
+		measure_rank_error(label, NULL, mq, depth, cfg->rank_ops);
+		destroy_multi_queue(mq);
+		snprintf(label, sizeof(label), "multi %zu by size", shard_counts[i]);
+		mq = create_multi_queue(shard_counts[i], MQ_RANDOM | MQ_BY_SIZE);
+		measure_rank_error(label, NULL, mq, depth, cfg->rank_ops);
+		destroy_multi_queue(mq);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-n shards_per_thread] [-t max_threads] [-d duration_ms]\n"
+		"       [-r rank_ops]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	t_bench_config cfg = {2, 8, 1000, 1000000};
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:t:d:r:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': cfg.shards_per_thread = atoi(optarg); break;
+			case 't': cfg.max_threads = atoi(optarg); break;
+			case 'd': cfg.duration_ms = atol(optarg); break;
+			case 'r': cfg.rank_ops = strtoul(optarg, NULL, 10); break;
+			default: return (usage(argv[0]), 1);
+		}
+	}
+	if (cfg.shards_per_thread < 1 || cfg.max_threads < 1 || cfg.duration_ms < 1 || !cfg.rank_ops)
+		return (usage(argv[0]), 1);
+
+	printf("=========================================\n");
+	printf("MULTI-QUEUE vs MS_QUEUE (%s shards)\n", MS_QUEUE_IMPL);
+	printf("=========================================\n");
+	printf("System: %d CPU cores available\n", (int)sysconf(_SC_NPROCESSORS_ONLN));
+
+	benchmark_scaling(&cfg);
+	benchmark_rank_error(&cfg);
+	return 0;
+}
@@ -1,36 +1,38 @@
 #include "ht.h"
 #include <stdlib.h>
 
-static inline size_t knuth_hash(int key, size_t mask)
+hashtable_t	*ht_create(size_t size)
 {
-	return (size_t)(key * 2654435761) & mask;
+	return ht_create_ex(size, 0);
 }
 
 // use pow-of-2 size to use bitwise AND in hash --> much better performance
-hashtable_t	*ht_create(size_t size)
+hashtable_t	*ht_create_ex(size_t size, int flags)
 {
 	hashtable_t	*ht = malloc(sizeof(hashtable_t));
 	if (!ht) return NULL;
 	size_t actual_size = 1;
 	while (actual_size < size) actual_size <<= 1;
-	ht->buckets = calloc(actual_size, sizeof(ht_entry_t *));
+	ht->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	ht->buckets = ht_alloc(actual_size * sizeof(ht_entry_t *), &ht->flags);
 	if (!ht->buckets) return (free(ht), NULL);
 	ht->size = actual_size;
 	ht->mask = actual_size - 1;
-	ht->hash_f = &knuth_hash;
+	ht->hash_f = &wyhash;
 	return ht;
 }
 
 // inserts new_entry at the head of the bucket, updates if key exists
-void	ht_insert(hashtable_t *ht, int key, void *value)
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = h & ht->mask;
 
 	// update
 	ht_entry_t *curr = ht->buckets[i];
 	while (curr)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&curr->key, key, len, h))
 		{
 			free(curr->value);
 			curr->value = value;
@@ -42,42 +44,45 @@ void	ht_insert(hashtable_t *ht, int key, void *value)
 	// insert
 	ht_entry_t *new_entry = malloc(sizeof(ht_entry_t));
 	if (!new_entry) return free(value);
-	new_entry->key = key;
+	if (!ht_key_set(&new_entry->key, key, len, h))
+		return (free(new_entry), free(value));
 	new_entry->value = value;
 	new_entry->next = ht->buckets[i];
 	ht->buckets[i] = new_entry;
 }
 
 // traverses the bucket's list; null if not found
-inline void	*ht_lookup(hashtable_t *ht, int key)
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
 {
-	size_t i = ht->hash_f(key, ht->mask);
-	ht_entry_t *entry = ht->buckets[i];
+	uint64_t h = ht->hash_f(key, len);
+	ht_entry_t *entry = ht->buckets[h & ht->mask];
 
 	if (entry && entry->next)
 		__builtin_prefetch(entry->next, 0, 1);
 	
 	while (entry) {
-		if (entry->key == key)
+		if (ht_key_eq(&entry->key, key, len, h))
 			return entry->value;
 		entry = entry->next;
 	}
 	return NULL;
 }
 
-void	ht_delete(hashtable_t *ht, int key)
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = h & ht->mask;
 	ht_entry_t *curr = ht->buckets[i];
 	ht_entry_t *prev = NULL;
 	while (curr)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&curr->key, key, len, h))
 		{
 			if (prev == NULL)
 				ht->buckets[i] = curr->next;
 			else
 				prev->next = curr->next;
+			ht_key_free(&curr->key);
 			free(curr->value);
 			free(curr);
 			return;
@@ -87,6 +92,21 @@ void	ht_delete(hashtable_t *ht, int key)
 	}
 }
 
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
+}
+
 // standard for malloc'd values
 void	ht_destroy(hashtable_t *ht)
 {
@@ -97,11 +117,12 @@ void	ht_destroy(hashtable_t *ht)
 		while (entry)
 		{
 			ht_entry_t *next = entry->next;
+			ht_key_free(&entry->key);
 			free(entry->value);
 			free(entry);
 			entry = next;
 		}
 	}
-	free(ht->buckets);
+	ht_free(ht->buckets, ht->size * sizeof(ht_entry_t *), ht->flags);
 	free(ht);
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+#ifndef HT_ALLOC_H
+# define HT_ALLOC_H
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+# endif
+# include <stdlib.h>
+# include <stdint.h>
+# include <sys/mman.h>
+
+// ht_create_ex flags
+# define HT_HUGEPAGE	1		// bucket arrays in 2MB pages, best effort
+# define HT_HUGETLB		2		// set if they all came from the hugetlb pool
+
+# define HT_HUGE_SIZE	(2UL << 20)
+
+static inline size_t ht_huge_len(size_t bytes)
+{
+	return (bytes + HT_HUGE_SIZE - 1) & ~(HT_HUGE_SIZE - 1);
+}
+
+// zeroed array: calloc, or with HT_HUGEPAGE MAP_HUGETLB and then a
+// 2MB-aligned mapping advised MADV_HUGEPAGE (clears HT_HUGETLB)
+static inline void *ht_alloc(size_t bytes, int *flags)
+{
+	if (!(*flags & HT_HUGEPAGE))
+		return calloc(1, bytes);
+	size_t len = ht_huge_len(bytes);
+	unsigned char *p = MAP_FAILED;
+# ifdef MAP_HUGETLB
+	if (*flags & HT_HUGETLB)
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+# endif
+	if (p != MAP_FAILED)
+		return p;
+	*flags &= ~HT_HUGETLB;
+	// over-map, trim to a 2MB boundary so THP can back all of it
+	unsigned char *raw = mmap(NULL, len + HT_HUGE_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED)
+		return NULL;
+	p = (unsigned char *)(((uintptr_t)raw + HT_HUGE_SIZE - 1) & ~(HT_HUGE_SIZE - 1));
+	if (p > raw)
+		munmap(raw, p - raw);
+	munmap(p + len, raw + HT_HUGE_SIZE - p);
+	madvise(p, len, MADV_HUGEPAGE);
+	return p;
+}
+
+static inline void ht_free(void *p, size_t bytes, int flags)
+{
+	if (!p)
+		return;
+	if (flags & HT_HUGEPAGE)
+		munmap(p, ht_huge_len(bytes));
+	else
+		free(p);
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef HT_KEY_H
+# define HT_KEY_H
+# include <stdlib.h>
+# include <stdint.h>
+# include <string.h>
+
+// byte keys: the full hash is kept next to the bytes so a mismatch is
+// usually rejected without touching them, keys up to HT_KEY_INLINE bytes
+// live in the entry itself, longer ones in their own allocation
+
+# define HT_KEY_INLINE	16
+
+typedef struct ht_key_s
+{
+	uint64_t	hash;
+	uint32_t	len;
+	union
+	{
+		unsigned char	bytes[HT_KEY_INLINE];
+		unsigned char	*ptr;		// len > HT_KEY_INLINE
+	};
+} ht_key_t;
+
+typedef uint64_t (*hash_function)(const void *key, size_t len);
+
+// wyhash (final4, public domain): 1-2 128-bit multiplies for keys up to
+// 16 bytes, three independent lanes over 48-byte blocks for long ones
+
+static const uint64_t	g_wyp[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+	0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+static inline void	wy_mum(uint64_t *a, uint64_t *b)
+{
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t	wy_mix(uint64_t a, uint64_t b)
+{
+	wy_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t	wy_r8(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static inline uint64_t	wy_r4(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint64_t	wy_r3(const unsigned char *p, size_t k)
+{
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t	wyhash(const void *key, size_t len)
+{
+	const unsigned char	*p = key;
+	uint64_t	seed = wy_mix(g_wyp[0], g_wyp[1]);
+	uint64_t	a, b;
+
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			a = (wy_r4(p) << 32) | wy_r4(p + ((len >> 3) << 2));
+			b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len > 0)
+		{
+			a = wy_r3(p, len);
+			b = 0;
+		}
+		else
+			a = b = 0;
+	}
+	else
+	{
+		size_t i = len;
+		if (i >= 48)
+		{
+			uint64_t see1 = seed, see2 = seed;
+			do
+			{
+				seed = wy_mix(wy_r8(p) ^ g_wyp[1], wy_r8(p + 8) ^ seed);
+				see1 = wy_mix(wy_r8(p + 16) ^ g_wyp[2], wy_r8(p + 24) ^ see1);
+				see2 = wy_mix(wy_r8(p + 32) ^ g_wyp[3], wy_r8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16)
+		{
+			seed = wy_mix(wy_r8(p) ^ g_wyp[1], wy_r8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wy_r8(p + i - 16);
+		b = wy_r8(p + i - 8);
+	}
+	a ^= g_wyp[1];
+	b ^= seed;
+	wy_mum(&a, &b);
+	return wy_mix(a ^ g_wyp[0] ^ len, b ^ g_wyp[1]);
+}
+
+static inline const unsigned char	*ht_key_bytes(const ht_key_t *k)
+{
+	return k->len > HT_KEY_INLINE ? k->ptr : k->bytes;
+}
+
+// copies the bytes in; 0 if a long key couldn't be allocated
+static inline int	ht_key_set(ht_key_t *k, const void *key, size_t len, uint64_t hash)
+{
+	k->hash = hash;
+	k->len = (uint32_t)len;
+	if (len <= HT_KEY_INLINE)
+		return (memcpy(k->bytes, key, len), 1);
+	k->ptr = malloc(len);
+	if (!k->ptr)
+		return 0;
+	memcpy(k->ptr, key, len);
+	return 1;
+}
+
+// inline keys: two overlapping word compares instead of a memcmp call
+static inline int	ht_key_eq(const ht_key_t *k, const void *key, size_t len, uint64_t hash)
+{
+	if (k->hash != hash || k->len != len)
+		return 0;
+	if (len > HT_KEY_INLINE)
+		return !memcmp(k->ptr, key, len);
+	const unsigned char *p = key;
+	if (len >= 8)
+		return wy_r8(k->bytes) == wy_r8(p) && wy_r8(k->bytes + len - 8) == wy_r8(p + len - 8);
+	if (len >= 4)
+		return wy_r4(k->bytes) == wy_r4(p) && wy_r4(k->bytes + len - 4) == wy_r4(p + len - 4);
+	return !len || wy_r3(k->bytes, len) == wy_r3(p, len);
+}
+
+static inline void	ht_key_free(ht_key_t *k)
+{
+	if (k->len > HT_KEY_INLINE)
+		free(k->ptr);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HT_RETIRE_H
+# define HT_RETIRE_H
+# include <stdlib.h>
+# include <urcu.h>
+
+// values replaced by an update: a reader inside rcu_read_lock may still
+// hold one, so it's freed after a grace period like a deleted entry
+
+typedef struct ht_retired
+{
+	void	*value;
+	struct rcu_head	rcu;
+} ht_retired_t;
+
+static inline void	ht_retired_free(struct rcu_head *rcu_head)
+{
+	ht_retired_t	*r = caa_container_of(rcu_head, ht_retired_t, rcu);
+	free(r->value);
+	free(r);
+}
+
+// queued with call_rcu, or without memory for that we wait the readers
+// out here: never call it inside a read-side critical section
+static inline void	ht_retire_value(void *value)
+{
+	if (!value)
+		return;
+	ht_retired_t *r = malloc(sizeof(ht_retired_t));
+	if (!r)
+		return (synchronize_rcu(), free(value));
+	r->value = value;
+	call_rcu(&r->rcu, ht_retired_free);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LF_HT_H
+# define LF_HT_H
+# define _GNU_SOURCE
+# include <unistd.h>
+# include <stdint.h>
+# include <stdatomic.h>
+# include "ht_alloc.h"
+# include "ht_key.h"
+# include <urcu.h>
+# include "ht_retire.h"
+
+// Lock-free: every bucket is a Harris-Michael list sorted by (hash, len,
+// bytes). Insert is one CAS on the predecessor's link, delete first marks
+// the node's own next pointer (low bit) so nothing can be linked after it,
+// then unlinks it; any traversal that meets a marked node unlinks it too.
+// Unlinked nodes are freed with call_rcu, and every operation runs inside
+// rcu_read_lock, so a node we hold can't be freed or reused under us (no
+// ABA). Threads must be registered with rcu_register_thread
+
+typedef struct lf_ht_node
+{
+	ht_key_t	key;
+	_Atomic(void *)	value;
+	_Atomic(uintptr_t)	next;	// bit 0: logically deleted
+	struct rcu_head	rcu;
+} lf_ht_node_t;
+
+// lock-free
+typedef struct hashtable_s
+{
+	_Atomic(uintptr_t)	*buckets;	// list heads, never marked
+	size_t	size;
+	size_t	mask;
+	hash_function hash_f;
+	int		flags;		// HT_HUGEPAGE, HT_HUGETLB
+} hashtable_t;
+
+hashtable_t	*ht_create(size_t size);
+hashtable_t	*ht_create_ex(size_t size, int flags);
+void	ht_destroy(hashtable_t *ht);
+
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value);
+void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len);
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len);
+
+// int keys, as their 4 bytes
+void	ht_insert(hashtable_t *ht, int key, void *value);
+void	*ht_lookup(hashtable_t *ht, int key);
+void	ht_delete(hashtable_t *ht, int key);
+
+#endif
@@ -2,36 +2,67 @@
 # define RCU_HT_H
 # define _GNU_SOURCE
 # include <unistd.h>
+# include "ht_alloc.h"
+# include "ht_key.h"
 # include <pthread.h>
 # include <urcu.h>
 # include <urcu/rcuhlist.h>
+# include "ht_retire.h"
 
 // rcu-protected linked-list
 typedef struct rcu_ht_entry
 {
-	int		key;
-	void	*value;
+	ht_key_t	key;
+	void	*value;		// rcu pointer, updates swap it in place
 	struct cds_hlist_node node;		// rcu list node instead of *next
 	struct rcu_head	rcu;			// for deferred free
 } rcu_ht_entry_t;
 
-typedef size_t (*hash_function)(int key, size_t size);
 typedef void (*free_function)(struct rcu_head *rcu_head);
 
-// rcu
-typedef struct hashtable_s
+// grow 2x once there are more entries than buckets
+# define HT_MAX_LOAD		1
+// old buckets a writer drains per operation while a resize is running
+# define HT_MIGRATE_STEP	8
+
+// bucket array, replaced as a whole on resize
+typedef struct rcu_ht_table
 {
 	struct cds_hlist_head	*buckets;
 	pthread_mutex_t	*bucket_locks;		// for writers
+	unsigned char	*drained;		// per old bucket, while we're being drained
 	size_t	size;
 	size_t	mask;
+	int		flags;		// what ht_alloc actually gave us
+	struct rcu_ht_table	*old;		// being drained into this one, or NULL
+	struct rcu_head	rcu;
+} rcu_ht_table_t;
+
+// rcu, grows online: a resize publishes a 2x table that points back at
+// the old one, writers move old buckets over a few at a time and lookups
+// look in both until the old table is empty and retired
+typedef struct hashtable_s
+{
+	rcu_ht_table_t	*table;		// rcu pointer
+	pthread_rwlock_t	resize_lock;	// writers shared, table swaps exclusive
+	size_t	size;		// buckets in the current table
+	long	count;
+	size_t	migrate_next;	// next old bucket to claim, modulo its size
+	size_t	migrated;
 	hash_function hash_f;
+	int		flags;		// HT_HUGEPAGE, HT_HUGETLB
 	free_function free_c;
 } hashtable_t;
 
 hashtable_t	*ht_create(size_t size);
+hashtable_t	*ht_create_ex(size_t size, int flags);
 void	ht_destroy(hashtable_t *ht);
 
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value);
+void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len);
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len);
+
+// int keys, as their 4 bytes
 void	ht_insert(hashtable_t *ht, int key, void *value);
 void	*ht_lookup(hashtable_t *ht, int key);
 void	ht_delete(hashtable_t *ht, int key);
@@ -2,18 +2,18 @@
 # define RW_HT_H
 # define _GNU_SOURCE
 # include <unistd.h>
+# include "ht_alloc.h"
+# include "ht_key.h"
 # include <pthread.h>
 
 // Linked-list
 typedef struct ht_entry_s
 {
-	int		key;
+	ht_key_t	key;
 	void	*value;
 	struct ht_entry_s	*next;
 } ht_entry_t;
 
-typedef size_t (*hash_function)(int key, size_t size);
-
 // rwlock
 typedef struct hashtable_s
 {
@@ -22,11 +22,18 @@ typedef struct hashtable_s
 	size_t	size;
 	size_t	mask;
 	hash_function hash_f;
+	int		flags;		// HT_HUGEPAGE, HT_HUGETLB
 } hashtable_t;
 
 hashtable_t	*ht_create(size_t size);
+hashtable_t	*ht_create_ex(size_t size, int flags);
 void	ht_destroy(hashtable_t *ht);
 
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value);
+void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len);
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len);
+
+// int keys, as their 4 bytes
 void	ht_insert(hashtable_t *ht, int key, void *value);
 void	*ht_lookup(hashtable_t *ht, int key);
 void	ht_delete(hashtable_t *ht, int key);
@@ -0,0 +1,65 @@
+#ifndef SO_HT_H
+# define SO_HT_H
+# define _GNU_SOURCE
+# include <unistd.h>
+# include <stdint.h>
+# include <stdatomic.h>
+# include "ht_alloc.h"
+# include "ht_key.h"
+# include <urcu.h>
+# include "ht_retire.h"
+
+// Split-ordered list (Shalev-Shavit): all entries sit in one lock-free
+// Harris-Michael list sorted by their bit-reversed hash, so the entries of
+// bucket b are contiguous and splitting b into b and b + size leaves them
+// in place. Each bucket is a dummy node in that same list, the directory
+// only points at them; doubling the table is one CAS on size and new
+// buckets get their dummy spliced in (after their parent's) on first use.
+// Nothing is ever rehashed or moved.
+//
+// Reclamation and thread rules are the lf_ht ones: operations run inside
+// rcu_read_lock, unlinked nodes are freed with call_rcu, threads must be
+// registered with rcu_register_thread
+
+// grow 2x once there are more entries than buckets
+# define SO_MAX_LOAD		1
+// segment s holds buckets [2^s, 2^(s+1)), segment 0 buckets 0 and 1
+# define SO_SEGMENTS		48
+
+typedef struct so_ht_node
+{
+	uint64_t	so_key;		// bit-reversed hash, LSB set for entries, clear for dummies
+	ht_key_t	key;
+	_Atomic(void *)	value;
+	_Atomic(uintptr_t)	next;	// bit 0: logically deleted
+	struct rcu_head	rcu;
+} so_ht_node_t;
+
+typedef _Atomic(so_ht_node_t *)	so_bucket_t;	// NULL until first used
+
+// split-ordered
+typedef struct hashtable_s
+{
+	_Atomic(so_bucket_t *)	segments[SO_SEGMENTS];	// allocated on demand
+	int		seg_flags[SO_SEGMENTS];	// what ht_alloc gave each one
+	so_ht_node_t	*head;		// bucket 0's dummy, start of the list
+	_Atomic(size_t)	size;		// buckets in use, pow-of-2
+	_Atomic(long)	count;
+	hash_function hash_f;
+	int		flags;		// HT_HUGEPAGE, HT_HUGETLB of the first segment
+} hashtable_t;
+
+hashtable_t	*ht_create(size_t size);
+hashtable_t	*ht_create_ex(size_t size, int flags);
+void	ht_destroy(hashtable_t *ht);
+
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value);
+void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len);
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len);
+
+// int keys, as their 4 bytes
+void	ht_insert(hashtable_t *ht, int key, void *value);
+void	*ht_lookup(hashtable_t *ht, int key);
+void	ht_delete(hashtable_t *ht, int key);
+
+#endif
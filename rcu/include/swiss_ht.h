@@ -0,0 +1,47 @@
+#ifndef SWISS_HT_H
+# define SWISS_HT_H
+# define _GNU_SOURCE
+# include <unistd.h>
+# include <stdint.h>
+# include "ht_alloc.h"
+# include "ht_key.h"
+
+// Open addressing, SwissTable layout: one control byte per slot (empty,
+// deleted, or the low 7 hash bits of a full slot) and a flat slot array.
+// A probe compares a whole group of control bytes against the key's 7 bits
+// with SSE2/AVX2 and only touches slots that match, so there is no
+// allocation per insert and no pointer chase per probe
+
+// key and value inline
+typedef struct swiss_slot_s
+{
+	ht_key_t	key;
+	void	*value;
+} swiss_slot_t;
+
+// swiss
+typedef struct hashtable_s
+{
+	int8_t	*ctrl;		// size + one group, the tail mirrors the head
+	swiss_slot_t	*slots;
+	size_t	size;		// slots, pow-of-2, at least one group
+	size_t	mask;
+	size_t	count;
+	size_t	growth_left;	// empty slots we may still fill before a rehash
+	hash_function hash_f;
+	int		flags;		// HT_HUGEPAGE, HT_HUGETLB
+} hashtable_t;
+
+hashtable_t	*ht_create(size_t size);
+hashtable_t	*ht_create_ex(size_t size, int flags);
+void	ht_destroy(hashtable_t *ht);
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value);
+void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len);
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len);
+
+// int keys, as their 4 bytes
+void	ht_insert(hashtable_t *ht, int key, void *value);
+void	*ht_lookup(hashtable_t *ht, int key);
+void	ht_delete(hashtable_t *ht, int key);
+
+#endif
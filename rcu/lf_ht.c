@@ -0,0 +1,221 @@
+#include "lf_ht.h"
+#include <stdlib.h>
+
+#define MARK		((uintptr_t)1)
+#define NODE(p)		((lf_ht_node_t *)((p) & ~MARK))
+
+static void	free_node_callback(struct rcu_head *rcu_head)
+{
+	lf_ht_node_t	*node = caa_container_of(rcu_head, lf_ht_node_t, rcu);
+	ht_key_free(&node->key);
+	free(atomic_load_explicit(&node->value, memory_order_relaxed));
+	free(node);
+}
+
+hashtable_t	*ht_create(size_t size)
+{
+	return ht_create_ex(size, 0);
+}
+
+// use pow-of-2 size to use bitwise AND in hash --> much better performance
+hashtable_t	*ht_create_ex(size_t size, int flags)
+{
+	hashtable_t	*ht = malloc(sizeof(hashtable_t));
+	if (!ht) return NULL;
+	size_t actual_size = 1;
+	while (actual_size < size) actual_size <<= 1;
+	ht->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	// zeroed: every list starts empty
+	ht->buckets = ht_alloc(actual_size * sizeof(_Atomic(uintptr_t)), &ht->flags);
+	if (!ht->buckets) return (free(ht), NULL);
+	ht->size = actual_size;
+	ht->mask = actual_size - 1;
+	ht->hash_f = &wyhash;
+	return ht;
+}
+
+// list order: hash, then length, then bytes (equal hashes are nearly
+// always the same key, the inline compare settles those)
+static inline int	key_cmp(const ht_key_t *k, const void *key, size_t len, uint64_t h)
+{
+	if (k->hash != h)
+		return k->hash < h ? -1 : 1;
+	if (ht_key_eq(k, key, len, h))
+		return 0;
+	if (k->len != len)
+		return k->len < len ? -1 : 1;
+	return memcmp(ht_key_bytes(k), key, len);
+}
+
+// Michael's find: stops at the first node >= key, *prev is the link that
+// points at it. Marked nodes on the way are unlinked and retired; if a
+// link changed under us we start over from the head
+static int	list_find(_Atomic(uintptr_t) *head, const void *key, size_t len,
+	uint64_t h, _Atomic(uintptr_t) **pprev, lf_ht_node_t **pcurr)
+{
+retry:;
+	_Atomic(uintptr_t) *prev = head;
+	uintptr_t curr = atomic_load_explicit(prev, memory_order_acquire);
+	while (curr)
+	{
+		lf_ht_node_t *node = NODE(curr);
+		uintptr_t next = atomic_load_explicit(&node->next, memory_order_acquire);
+		if (next & MARK)
+		{
+			if (!atomic_compare_exchange_strong_explicit(prev, &curr, next & ~MARK,
+				memory_order_acq_rel, memory_order_acquire))
+				goto retry;
+			call_rcu(&node->rcu, free_node_callback);
+			curr = next & ~MARK;
+			continue;
+		}
+		int cmp = key_cmp(&node->key, key, len, h);
+		if (cmp >= 0)
+		{
+			*pprev = prev;
+			*pcurr = node;
+			return cmp == 0;
+		}
+		prev = &node->next;
+		curr = next;
+	}
+	*pprev = prev;
+	*pcurr = NULL;
+	return 0;
+}
+
+static lf_ht_node_t	*node_create(const void *key, size_t len, uint64_t h, void *value)
+{
+	lf_ht_node_t *node = malloc(sizeof(lf_ht_node_t));
+	if (!node)
+		return NULL;
+	if (!ht_key_set(&node->key, key, len, h))
+		return (free(node), NULL);
+	atomic_init(&node->value, value);
+	return node;
+}
+
+// links a new node in front of the first greater one, updates if key
+// exists. A replaced value is retired once we're out of the read-side
+// section: lookups may still be returning it
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
+{
+	uint64_t h = ht->hash_f(key, len);
+	_Atomic(uintptr_t) *head = &ht->buckets[h & ht->mask];
+	_Atomic(uintptr_t) *prev;
+	lf_ht_node_t *curr;
+	lf_ht_node_t *node = NULL;		// allocated once we know it's an insert
+
+	rcu_read_lock();
+	for (;;)
+	{
+		// update
+		if (list_find(head, key, len, h, &prev, &curr))
+		{
+			void *old = atomic_exchange_explicit(&curr->value, value, memory_order_acq_rel);
+			rcu_read_unlock();
+			ht_retire_value(old);
+			if (node)
+				ht_key_free(&node->key);
+			return free(node);
+		}
+		if (!node && !(node = node_create(key, len, h, value)))
+			return (rcu_read_unlock(), free(value));
+		// insert: publish the node with one CAS, release makes it whole
+		uintptr_t expected = (uintptr_t)curr;
+		atomic_store_explicit(&node->next, expected, memory_order_relaxed);
+		if (atomic_compare_exchange_strong_explicit(prev, &expected, (uintptr_t)node,
+			memory_order_release, memory_order_relaxed))
+			break;
+	}
+	rcu_read_unlock();
+}
+
+// wait-free traversal: marked nodes are skipped, not unlinked
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	uint64_t h = ht->hash_f(key, len);
+	void	*result = NULL;
+
+	rcu_read_lock();
+	uintptr_t curr = atomic_load_explicit(&ht->buckets[h & ht->mask], memory_order_acquire);
+	while (curr)
+	{
+		lf_ht_node_t *node = NODE(curr);
+		uintptr_t next = atomic_load_explicit(&node->next, memory_order_acquire);
+		int cmp = key_cmp(&node->key, key, len, h);
+		if (cmp > 0)
+			break;
+		if (cmp == 0 && !(next & MARK))
+		{
+			result = atomic_load_explicit(&node->value, memory_order_acquire);
+			break;
+		}
+		curr = next;
+	}
+	rcu_read_unlock();
+	return result;
+}
+
+// marking is the linearization point; whoever unlinks the node retires it
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	uint64_t h = ht->hash_f(key, len);
+	_Atomic(uintptr_t) *head = &ht->buckets[h & ht->mask];
+	_Atomic(uintptr_t) *prev;
+	lf_ht_node_t *curr;
+
+	rcu_read_lock();
+	while (list_find(head, key, len, h, &prev, &curr))
+	{
+		uintptr_t next = atomic_load_explicit(&curr->next, memory_order_acquire);
+		if (next & MARK)
+			continue;		// lost to another delete, find unlinks it
+		if (!atomic_compare_exchange_strong_explicit(&curr->next, &next, next | MARK,
+			memory_order_acq_rel, memory_order_relaxed))
+			continue;
+		uintptr_t expected = (uintptr_t)curr;
+		if (atomic_compare_exchange_strong_explicit(prev, &expected, next,
+			memory_order_acq_rel, memory_order_relaxed))
+			call_rcu(&curr->rcu, free_node_callback);
+		else
+			list_find(head, key, len, h, &prev, &curr);
+		break;
+	}
+	rcu_read_unlock();
+}
+
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
+}
+
+// no concurrent users left: marked nodes still linked are freed too
+void	ht_destroy(hashtable_t *ht)
+{
+	if (!ht) return;
+	for (size_t i = 0; i < ht->size; i++)
+	{
+		uintptr_t curr = atomic_load_explicit(&ht->buckets[i], memory_order_relaxed);
+		while (curr)
+		{
+			lf_ht_node_t *node = NODE(curr);
+			curr = atomic_load_explicit(&node->next, memory_order_relaxed);
+			ht_key_free(&node->key);
+			free(atomic_load_explicit(&node->value, memory_order_relaxed));
+			free(node);
+		}
+	}
+	ht_free(ht->buckets, ht->size * sizeof(_Atomic(uintptr_t)), ht->flags);
+	free(ht);
+}
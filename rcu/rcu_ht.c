@@ -1,20 +1,68 @@
 #include "rcu_ht.h"
 #include <stdlib.h>
 
-static inline size_t knuth_hash(int key, size_t mask)
-{
-	return (size_t)(key * 2654435761) & mask;
-}
-
 // retrieves the entry from the wait-free queue rcu-head
 static inline void free_callback(struct rcu_head *rcu_head)
 {
 	rcu_ht_entry_t	*entry = caa_container_of(rcu_head, rcu_ht_entry_t, rcu);
+	ht_key_free(&entry->key);
 	free(entry->value);
 	free(entry);
 }
+
+// moved entries: the copy in the new table owns key and value now
+static void free_entry_callback(struct rcu_head *rcu_head)
+{
+	free(caa_container_of(rcu_head, rcu_ht_entry_t, rcu));
+}
+
 // use pow-of-2 size to use bitwise AND in hash --> much better performance
+static rcu_ht_table_t	*table_create(size_t size, int flags)
+{
+	rcu_ht_table_t	*t = malloc(sizeof(rcu_ht_table_t));
+	if (!t)
+		return NULL;
+	t->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	t->buckets = ht_alloc(size * sizeof(struct cds_hlist_head), &t->flags);
+	if (!t->buckets)
+		return (free(t), NULL);
+	for (size_t i = 0; i < size; i++)
+		CDS_INIT_HLIST_HEAD(&t->buckets[i]);
+	t->bucket_locks = ht_alloc(size * sizeof(pthread_mutex_t), &t->flags);
+	if (!t->bucket_locks)
+		return (ht_free(t->buckets, size * sizeof(struct cds_hlist_head), t->flags),
+			free(t), NULL);
+	for (size_t i = 0; i < size; i++)
+		pthread_mutex_init(&t->bucket_locks[i], NULL);
+	t->drained = NULL;
+	t->size = size;
+	t->mask = size - 1;
+	t->old = NULL;
+	return t;
+}
+
+// entries must already be gone
+static void	table_free(rcu_ht_table_t *t)
+{
+	for (size_t i = 0; i < t->size; i++)
+		pthread_mutex_destroy(&t->bucket_locks[i]);
+	ht_free(t->buckets, t->size * sizeof(struct cds_hlist_head), t->flags);
+	ht_free(t->bucket_locks, t->size * sizeof(pthread_mutex_t), t->flags);
+	free(t->drained);
+	free(t);
+}
+
+static void	free_table_callback(struct rcu_head *rcu_head)
+{
+	table_free(caa_container_of(rcu_head, rcu_ht_table_t, rcu));
+}
+
 hashtable_t	*ht_create(size_t size)
+{
+	return ht_create_ex(size, 0);
+}
+
+hashtable_t	*ht_create_ex(size_t size, int flags)
 {
 	hashtable_t	*ht = malloc(sizeof(hashtable_t));
 	if (!ht)
@@ -22,128 +70,307 @@ hashtable_t	*ht_create(size_t size)
 	size_t actual_size = 1;
 	while (actual_size < size)
 		actual_size <<= 1;
-	ht->buckets = calloc(actual_size, sizeof(struct cds_hlist_head));
-	if (!ht->buckets)
+	ht->table = table_create(actual_size, flags);
+	if (!ht->table)
 		return (free(ht), NULL);
-	for (size_t i = 0; i < actual_size; i++)
-		CDS_INIT_HLIST_HEAD(&ht->buckets[i]);
-	ht->bucket_locks = malloc(actual_size * sizeof(pthread_mutex_t));
-	if (!ht->bucket_locks)
-		return (free(ht->buckets), free(ht), NULL);
-	for (size_t i = 0; i < actual_size; i++)
-		pthread_mutex_init(&ht->bucket_locks[i], NULL);
+	pthread_rwlock_init(&ht->resize_lock, NULL);
 	ht->size = actual_size;
-	ht->mask = actual_size - 1;
-	ht->hash_f = &knuth_hash;
+	ht->count = 0;
+	ht->migrate_next = 0;
+	ht->migrated = 0;
+	ht->hash_f = &wyhash;
+	ht->flags = ht->table->flags;
 	ht->free_c = &free_callback;
 	return ht;
 }
 
-// inserts new_entry at the head of the bucket, updates if key exists
-void	ht_insert(hashtable_t *ht, int key, void *value)
+// ============== Resize ==============
+
+// moves old bucket j into t. Each entry is copied in before it is unlinked,
+// so a lookup that misses it in the old bucket finds it in the new one
+static int	drain_bucket(hashtable_t *ht, rcu_ht_table_t *t, size_t j)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	rcu_ht_table_t	*old = t->old;
+	rcu_ht_entry_t	*entry, *tmp;
+
+	pthread_mutex_lock(&old->bucket_locks[j]);
+	if (old->drained[j])
+		return (pthread_mutex_unlock(&old->bucket_locks[j]), 1);
+	cds_hlist_for_each_entry_safe_2(entry, tmp, &old->buckets[j], node)
+	{
+		rcu_ht_entry_t *copy = malloc(sizeof(rcu_ht_entry_t));
+		if (!copy)		// what's left stays in old, still found there
+			return (pthread_mutex_unlock(&old->bucket_locks[j]), 0);
+		copy->key = entry->key;
+		copy->value = entry->value;
+		size_t i = entry->key.hash & t->mask;
+		pthread_mutex_lock(&t->bucket_locks[i]);
+		cds_hlist_add_head_rcu(&copy->node, &t->buckets[i]);
+		pthread_mutex_unlock(&t->bucket_locks[i]);
+		cmm_smp_wmb();
+		cds_hlist_del_rcu(&entry->node);
+		call_rcu(&entry->rcu, free_entry_callback);
+	}
+	uatomic_set(&old->drained[j], 1);
+	uatomic_inc(&ht->migrated);
+	pthread_mutex_unlock(&old->bucket_locks[j]);
+	return 1;
+}
+
+// shared resize lock held on return. While a resize runs, the key's old
+// bucket is drained first (a key is then only ever in the new table for
+// writers), plus a few more. If the key's bucket couldn't be drained for
+// lack of memory, *undrained is the old table and the key may still be
+// there; NULL otherwise
+static rcu_ht_table_t	*writer_enter(hashtable_t *ht, uint64_t h,
+	rcu_ht_table_t **undrained)
+{
+	pthread_rwlock_rdlock(&ht->resize_lock);
+	rcu_ht_table_t	*t = ht->table;
+	rcu_ht_table_t	*old = t->old;
+	*undrained = NULL;
+	if (!old)
+		return t;
+	if (!drain_bucket(ht, t, h & old->mask))
+		*undrained = old;
+	// claims wrap around: a bucket whose drain failed for lack of memory
+	// comes up again on a later pass, until every one is drained
+	for (int k = 0; k < HT_MIGRATE_STEP; k++)
+	{
+		size_t j = (uatomic_add_return(&ht->migrate_next, 1) - 1) & old->mask;
+		if (!uatomic_read(&old->drained[j]))
+			drain_bucket(ht, t, j);
+	}
+	return t;
+}
+
+// publishes the 2x table. Writers are held off until every lookup that may
+// still use cur alone is over, then they start draining it
+static void	start_resize(hashtable_t *ht, rcu_ht_table_t *cur)
+{
+	pthread_rwlock_wrlock(&ht->resize_lock);
+	if (ht->table != cur || cur->old)
+		return (void)pthread_rwlock_unlock(&ht->resize_lock);
+	rcu_ht_table_t	*t = table_create(cur->size * 2, ht->flags & HT_HUGEPAGE);
+	cur->drained = calloc(cur->size, 1);
+	if (!t || !cur->drained)	// stays at this size, retried on a later insert
+	{
+		if (t)
+			table_free(t);
+		free(cur->drained);
+		cur->drained = NULL;
+		return (void)pthread_rwlock_unlock(&ht->resize_lock);
+	}
+	t->old = cur;
+	ht->migrate_next = 0;
+	ht->migrated = 0;
+	rcu_assign_pointer(ht->table, t);
+	ht->size = t->size;
+	ht->flags = t->flags;
+	synchronize_rcu();
+	pthread_rwlock_unlock(&ht->resize_lock);
+}
+
+// every old bucket is drained: unhook the old table, freed after readers
+static void	finish_resize(hashtable_t *ht, rcu_ht_table_t *t)
+{
+	pthread_rwlock_wrlock(&ht->resize_lock);
+	rcu_ht_table_t	*old = t->old;
+	if (ht->table == t && old)
+	{
+		rcu_assign_pointer(t->old, NULL);
+		call_rcu(&old->rcu, free_table_callback);
+	}
+	pthread_rwlock_unlock(&ht->resize_lock);
+}
+
+static void	writer_exit(hashtable_t *ht, rcu_ht_table_t *t, long count)
+{
+	int	done = t->old && uatomic_read(&ht->migrated) == t->old->size;
+	int	grow = !t->old && count > (long)(t->size * HT_MAX_LOAD);
+
+	pthread_rwlock_unlock(&ht->resize_lock);
+	if (done)
+		finish_resize(ht, t);
+	else if (grow)
+		start_resize(ht, t);
+}
+
+// ============== Operations ==============
+
+// inserts new_entry at the head of the bucket, updates if key exists;
+// 1 if the key is new, 0 if updated or out of memory
+static int	bucket_insert(rcu_ht_table_t *t, const void *key, size_t len,
+	uint64_t h, void *value)
+{
+	size_t i = h & t->mask;
 	rcu_ht_entry_t *curr = NULL;
 
-	pthread_mutex_lock(&ht->bucket_locks[i]);
+	pthread_mutex_lock(&t->bucket_locks[i]);
 
 	// update
-	cds_hlist_for_each_entry_2(curr, &ht->buckets[i], node)
+	cds_hlist_for_each_entry_2(curr, &t->buckets[i], node)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&curr->key, key, len, h))
 		{
-			// remove old entry from table
-			cds_hlist_del_rcu(&curr->node);
-			//new entry
-			rcu_ht_entry_t *new_entry = malloc(sizeof(rcu_ht_entry_t));
-			if (!new_entry)
-			{	//restore old entry
-				cds_hlist_add_head_rcu(&curr->node, &ht->buckets[i]);
-				pthread_mutex_unlock(&ht->bucket_locks[i]);
-				free(value);
-				return;
-			}
-			new_entry->key = key;
-			new_entry->value = value;
-
-			// insert new entry
-			cds_hlist_add_head_rcu(&new_entry->node, &ht->buckets[i]);
-			pthread_mutex_unlock(&ht->bucket_locks[i]);
-			//deferred free of old entry
-			call_rcu(&curr->rcu, free_callback);
-			return;
+			// swap the value in place, the list isn't touched: readers
+			// get the old value or the new one, never a missing key
+			void *old = rcu_xchg_pointer(&curr->value, value);
+			pthread_mutex_unlock(&t->bucket_locks[i]);
+			ht_retire_value(old);
+			return 0;
 		}
 	}
 	
 	// insert: create entry then swing ptr
 	rcu_ht_entry_t *new_entry = malloc(sizeof(rcu_ht_entry_t));
-	if (!new_entry) return (pthread_mutex_unlock(&ht->bucket_locks[i]), free(value));
-	new_entry->key = key;
+	if (!new_entry || !ht_key_set(&new_entry->key, key, len, h))
+		return (pthread_mutex_unlock(&t->bucket_locks[i]), free(new_entry), free(value), 0);
 	new_entry->value = value;
-	cds_hlist_add_head_rcu(&new_entry->node, &ht->buckets[i]);
+	cds_hlist_add_head_rcu(&new_entry->node, &t->buckets[i]);
+
+	pthread_mutex_unlock(&t->bucket_locks[i]);
+	return 1;
+}
+
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
+{
+	uint64_t	h = ht->hash_f(key, len);
+	rcu_ht_table_t	*undrained;
+	rcu_ht_table_t	*t = writer_enter(ht, h, &undrained);
+	if (undrained)		// would need the memory the drain couldn't get
+		return (writer_exit(ht, t, 0), free(value));
+	long	count = 0;
+	if (bucket_insert(t, key, len, h, value))
+		count = uatomic_add_return(&ht->count, 1);
+	writer_exit(ht, t, count);
+}
 
-	pthread_mutex_unlock(&ht->bucket_locks[i]);
+static inline rcu_ht_entry_t	*bucket_lookup(struct cds_hlist_head *bucket,
+	const void *key, size_t len, uint64_t h)
+{
+	rcu_ht_entry_t *entry = NULL;
+
+	cds_hlist_for_each_entry_rcu_2(entry, bucket, node)
+	{
+		if (ht_key_eq(&entry->key, key, len, h))
+			return entry;
+	}
+	return NULL;
 }
 
-// traverses the bucket's list; null if not found
-inline void	*ht_lookup(hashtable_t *ht, int key)
+// traverses the bucket's list; null if not found. Mid-resize the old
+// bucket goes first: entries only ever move from old to new
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t	h = ht->hash_f(key, len);
 	rcu_ht_entry_t *entry = NULL;
 	void	*result = NULL;
 
 	rcu_read_lock();
 
-	cds_hlist_for_each_entry_rcu_2(entry, &ht->buckets[i], node)
-	{
-		if (entry->key == key)
-		{
-			result = entry->value;
-			break;
-		}
-	}
+	rcu_ht_table_t	*t = rcu_dereference(ht->table);
+	rcu_ht_table_t	*old = rcu_dereference(t->old);
+	if (old)
+		entry = bucket_lookup(&old->buckets[h & old->mask], key, len, h);
+	cmm_smp_rmb();		// pairs with the wmb in drain_bucket
+	if (!entry)
+		entry = bucket_lookup(&t->buckets[h & t->mask], key, len, h);
+	if (entry)
+		result = rcu_dereference(entry->value);
 
 	rcu_read_unlock();
 	return result;
 }
 
-void	ht_delete(hashtable_t *ht, int key)
+static rcu_ht_entry_t	*bucket_unlink(struct cds_hlist_head *bucket,
+	const void *key, size_t len, uint64_t h)
 {
-	size_t i = ht->hash_f(key, ht->mask);
-	rcu_ht_entry_t *curr = NULL;
+	rcu_ht_entry_t *entry = NULL;
 
-	pthread_mutex_lock(&ht->bucket_locks[i]);
-	cds_hlist_for_each_entry_2(curr, &ht->buckets[i], node)
+	cds_hlist_for_each_entry_2(entry, bucket, node)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&entry->key, key, len, h))
 		{
-			cds_hlist_del_rcu(&curr->node);
-			pthread_mutex_unlock(&ht->bucket_locks[i]);
-			call_rcu(&curr->rcu, ht->free_c);
-			return;
+			cds_hlist_del_rcu(&entry->node);
+			return entry;
 		}
 	}
-	pthread_mutex_unlock(&ht->bucket_locks[i]);
+	return NULL;
+}
+
+// needs no memory: if the key's old bucket couldn't be drained, the key
+// is in it or in the new one, and holding both locks (old first, as the
+// drain does) keeps it from moving while we look
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	uint64_t	h = ht->hash_f(key, len);
+	rcu_ht_table_t	*old;
+	rcu_ht_table_t	*t = writer_enter(ht, h, &old);
+	size_t	i = h & t->mask;
+	size_t	j = old ? h & old->mask : 0;
+	rcu_ht_entry_t *entry = NULL;
+
+	if (old)
+		pthread_mutex_lock(&old->bucket_locks[j]);
+	pthread_mutex_lock(&t->bucket_locks[i]);
+	if (old)
+		entry = bucket_unlink(&old->buckets[j], key, len, h);
+	if (!entry)
+		entry = bucket_unlink(&t->buckets[i], key, len, h);
+	pthread_mutex_unlock(&t->bucket_locks[i]);
+	if (old)
+		pthread_mutex_unlock(&old->bucket_locks[j]);
+	if (entry)
+	{
+		call_rcu(&entry->rcu, ht->free_c);
+		uatomic_dec(&ht->count);
+	}
+	writer_exit(ht, t, 0);
+}
+
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
 }
 
 // standard for malloc'd values
-void	ht_destroy(hashtable_t *ht)
+static void	table_clear(rcu_ht_table_t *t)
 {
-	if (!ht) return;
-	for (size_t i = 0; i < ht->size; i++)
+	for (size_t i = 0; i < t->size; i++)
 	{
-		pthread_mutex_lock(&ht->bucket_locks[i]);
 		rcu_ht_entry_t *entry, *tmp;
-		cds_hlist_for_each_entry_safe_2(entry, tmp, &ht->buckets[i], node)
+		cds_hlist_for_each_entry_safe_2(entry, tmp, &t->buckets[i], node)
 		{
 			cds_hlist_del(&entry->node);
+			ht_key_free(&entry->key);
 			free(entry->value);
 			free(entry);
 		}
-		pthread_mutex_unlock(&ht->bucket_locks[i]);
-		pthread_mutex_destroy(&ht->bucket_locks[i]);
 	}
-	free(ht->buckets);
-	free(ht->bucket_locks);
+}
+
+void	ht_destroy(hashtable_t *ht)
+{
+	if (!ht) return;
+	rcu_ht_table_t	*t = ht->table;
+	if (t->old)
+	{
+		table_clear(t->old);
+		table_free(t->old);
+	}
+	table_clear(t);
+	table_free(t);
+	pthread_rwlock_destroy(&ht->resize_lock);
 	free(ht);
-}
\ No newline at end of file
+}
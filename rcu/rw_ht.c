@@ -1,35 +1,37 @@
 #include "rw_ht.h"
 #include <stdlib.h>
 
-static inline size_t knuth_hash(int key, size_t mask)
+hashtable_t	*ht_create(size_t size)
 {
-	return (size_t)(key * 2654435761) & mask;
+	return ht_create_ex(size, 0);
 }
 
 // use pow-of-2 size to use bitwise AND in hash --> much better performance
-hashtable_t	*ht_create(size_t size)
+hashtable_t	*ht_create_ex(size_t size, int flags)
 {
 	hashtable_t	*ht = malloc(sizeof(hashtable_t));
 	if (!ht) return NULL;
 	size_t actual_size = 1;
 	while (actual_size < size) actual_size <<= 1;
-	ht->buckets = calloc(actual_size, sizeof(ht_entry_t *));
+	ht->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	ht->buckets = ht_alloc(actual_size * sizeof(ht_entry_t *), &ht->flags);
 	if (!ht->buckets) return (free(ht), NULL);
-	ht->size = 0;		// to use ht_destroy safely
-	ht->bucket_locks = malloc(actual_size * sizeof(pthread_rwlock_t));
-	if (!ht->bucket_locks) return (ht_destroy(ht), NULL);
+	ht->bucket_locks = ht_alloc(actual_size * sizeof(pthread_rwlock_t), &ht->flags);
+	if (!ht->bucket_locks)
+		return (ht_free(ht->buckets, actual_size * sizeof(ht_entry_t *), ht->flags), free(ht), NULL);
 	for (size_t i = 0; i < actual_size; i++)
 		pthread_rwlock_init(&ht->bucket_locks[i], NULL);
 	ht->size = actual_size;
 	ht->mask = actual_size - 1;
-	ht->hash_f = &knuth_hash;
+	ht->hash_f = &wyhash;
 	return ht;
 }
 
 // inserts new_entry at the head of the bucket, updates if key exists
-void	ht_insert(hashtable_t *ht, int key, void *value)
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = h & ht->mask;
 
 	pthread_rwlock_wrlock(&ht->bucket_locks[i]);
 	
@@ -37,7 +39,7 @@ void	ht_insert(hashtable_t *ht, int key, void *value)
 	ht_entry_t *curr = ht->buckets[i];
 	while (curr)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&curr->key, key, len, h))
 		{
 			free(curr->value);
 			curr->value = value;
@@ -54,7 +56,11 @@ void	ht_insert(hashtable_t *ht, int key, void *value)
 		pthread_rwlock_unlock(&ht->bucket_locks[i]);
 		return free(value);
 	}
-	new_entry->key = key;
+	if (!ht_key_set(&new_entry->key, key, len, h))
+	{
+		pthread_rwlock_unlock(&ht->bucket_locks[i]);
+		return (free(new_entry), free(value));
+	}
 	new_entry->value = value;
 	new_entry->next = ht->buckets[i];
 	ht->buckets[i] = new_entry;
@@ -63,9 +69,10 @@ void	ht_insert(hashtable_t *ht, int key, void *value)
 }
 
 // traverses the bucket's list; null if not found
-inline void	*ht_lookup(hashtable_t *ht, int key)
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = h & ht->mask;
 	void	*result = NULL;
 
 	pthread_rwlock_rdlock(&ht->bucket_locks[i]);
@@ -75,7 +82,7 @@ inline void	*ht_lookup(hashtable_t *ht, int key)
 		__builtin_prefetch(entry->next, 0, 1);
 	
 	while (entry) {
-		if (entry->key == key)
+		if (ht_key_eq(&entry->key, key, len, h))
 			result = entry->value;
 		entry = entry->next;
 	}
@@ -84,9 +91,10 @@ inline void	*ht_lookup(hashtable_t *ht, int key)
 	return result;
 }
 
-void	ht_delete(hashtable_t *ht, int key)
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
 {
-	size_t i = ht->hash_f(key, ht->mask);
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = h & ht->mask;
 
 	pthread_rwlock_wrlock(&ht->bucket_locks[i]);
 
@@ -94,12 +102,13 @@ void	ht_delete(hashtable_t *ht, int key)
 	ht_entry_t *prev = NULL;
 	while (curr)
 	{
-		if (curr->key == key)
+		if (ht_key_eq(&curr->key, key, len, h))
 		{
 			if (prev == NULL)
 				ht->buckets[i] = curr->next;
 			else
 				prev->next = curr->next;
+			ht_key_free(&curr->key);
 			free(curr->value);
 			free(curr);
 			pthread_rwlock_unlock(&ht->bucket_locks[i]);
@@ -112,6 +121,21 @@ void	ht_delete(hashtable_t *ht, int key)
 	pthread_rwlock_unlock(&ht->bucket_locks[i]);
 }
 
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
+}
+
 // frees locks before data
 void	ht_destroy(hashtable_t *ht)
 {
@@ -119,7 +143,7 @@ void	ht_destroy(hashtable_t *ht)
 	
 	for (size_t i = 0; i < ht->size; i++)
 		pthread_rwlock_destroy(&ht->bucket_locks[i]);
-	free(ht->bucket_locks);	
+	ht_free(ht->bucket_locks, ht->size * sizeof(pthread_rwlock_t), ht->flags);
 
 	for (size_t i = 0; i < ht->size; i++)
 	{
@@ -127,11 +151,12 @@ void	ht_destroy(hashtable_t *ht)
 		while (entry)
 		{
 			ht_entry_t *next = entry->next;
+			ht_key_free(&entry->key);
 			free(entry->value);
 			free(entry);
 			entry = next;
 		}
 	}
-	free(ht->buckets);
+	ht_free(ht->buckets, ht->size * sizeof(ht_entry_t *), ht->flags);
 	free(ht);
 }
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "so_ht.h"
+#include <stdlib.h>
+
+#define MARK		((uintptr_t)1)
+#define NODE(p)		((so_ht_node_t *)((p) & ~MARK))
+
+// the last segment's buckets, doubling stops there
+#define SO_MAX_BUCKETS	((size_t)1 << SO_SEGMENTS)
+
+static void	free_node_callback(struct rcu_head *rcu_head)
+{
+	so_ht_node_t	*node = caa_container_of(rcu_head, so_ht_node_t, rcu);
+	ht_key_free(&node->key);
+	free(atomic_load_explicit(&node->value, memory_order_relaxed));
+	free(node);
+}
+
+static inline uint64_t	bitrev64(uint64_t x)
+{
+	x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	return __builtin_bswap64(x);
+}
+
+// entries sort after their bucket's dummy (same low bits, reversed, plus
+// LSB) and before the dummy of any bucket split off it later
+static inline uint64_t	so_regular(uint64_t h)
+{
+	return bitrev64(h) | 1;
+}
+
+static inline uint64_t	so_dummy(size_t b)
+{
+	return bitrev64(b);
+}
+
+// ============== Bucket directory ==============
+
+static inline int	seg_of(size_t b)
+{
+	return b < 2 ? 0 : 63 - __builtin_clzl(b);
+}
+
+static inline size_t	seg_base(int s)
+{
+	return s ? (size_t)1 << s : 0;
+}
+
+static inline size_t	seg_bytes(int s)
+{
+	return (s ? (size_t)1 << s : 2) * sizeof(so_bucket_t);
+}
+
+// b with its top bit cleared: the bucket b was split from
+static inline size_t	parent_of(size_t b)
+{
+	return b & ~((size_t)1 << (63 - __builtin_clzl(b)));
+}
+
+// zeroed, every bucket uninitialized. Segments below 2MB would waste
+// most of a huge page, they always come from calloc
+static so_bucket_t	*segment_alloc(hashtable_t *ht, int s, int *flags)
+{
+	*flags = seg_bytes(s) >= HT_HUGE_SIZE ? ht->flags : 0;
+	return ht_alloc(seg_bytes(s), flags);
+}
+
+// b's directory slot, NULL if its segment doesn't exist (yet, or
+// allocation failed). Racing allocators: one CAS wins, the others free
+static so_bucket_t	*bucket_slot(hashtable_t *ht, size_t b, int alloc)
+{
+	int s = seg_of(b);
+	so_bucket_t *seg = atomic_load_explicit(&ht->segments[s], memory_order_acquire);
+	if (!seg)
+	{
+		int flags;
+		so_bucket_t *fresh;
+		if (!alloc || !(fresh = segment_alloc(ht, s, &flags)))
+			return NULL;
+		if (atomic_compare_exchange_strong_explicit(&ht->segments[s], &seg, fresh,
+			memory_order_acq_rel, memory_order_acquire))
+		{
+			ht->seg_flags[s] = flags;
+			seg = fresh;
+		}
+		else
+			ht_free(fresh, seg_bytes(s), flags);
+	}
+	return &seg[b - seg_base(s)];
+}
+
+// ============== List ==============
+
+// list order: split-order key, then for entries hash, length, bytes
+// (equal hashes are nearly always the same key, the inline compare
+// settles those). Dummies only ever match themselves
+static inline int	node_cmp(const so_ht_node_t *n, uint64_t so_key,
+	const void *key, size_t len, uint64_t h)
+{
+	if (n->so_key != so_key)
+		return n->so_key < so_key ? -1 : 1;
+	if (!(so_key & 1))
+		return 0;
+	const ht_key_t *k = &n->key;
+	if (k->hash != h)
+		return k->hash < h ? -1 : 1;
+	if (ht_key_eq(k, key, len, h))
+		return 0;
+	if (k->len != len)
+		return k->len < len ? -1 : 1;
+	return memcmp(ht_key_bytes(k), key, len);
+}
+
+// Michael's find from a dummy: stops at the first node >= key, *prev is
+// the link that points at it. Marked nodes on the way are unlinked and
+// retired; if a link changed under us we start over from the dummy,
+// which is never deleted
+static int	list_find(so_ht_node_t *start, uint64_t so_key, const void *key,
+	size_t len, uint64_t h, _Atomic(uintptr_t) **pprev, so_ht_node_t **pcurr)
+{
+retry:;
+	_Atomic(uintptr_t) *prev = &start->next;
+	uintptr_t curr = atomic_load_explicit(prev, memory_order_acquire);
+	while (curr)
+	{
+		so_ht_node_t *node = NODE(curr);
+		uintptr_t next = atomic_load_explicit(&node->next, memory_order_acquire);
+		if (next & MARK)
+		{
+			if (!atomic_compare_exchange_strong_explicit(prev, &curr, next & ~MARK,
+				memory_order_acq_rel, memory_order_acquire))
+				goto retry;
+			call_rcu(&node->rcu, free_node_callback);
+			curr = next & ~MARK;
+			continue;
+		}
+		int cmp = node_cmp(node, so_key, key, len, h);
+		if (cmp >= 0)
+		{
+			*pprev = prev;
+			*pcurr = node;
+			return cmp == 0;
+		}
+		prev = &node->next;
+		curr = next;
+	}
+	*pprev = prev;
+	*pcurr = NULL;
+	return 0;
+}
+
+// b's dummy, spliced in after its parent's (initialized first, so the
+// recursion is at most log2(size) deep). Whoever loses the race to link
+// it adopts the winner's. NULL if out of memory
+static so_ht_node_t	*bucket_init(hashtable_t *ht, size_t b)
+{
+	so_bucket_t *slot = bucket_slot(ht, b, 1);
+	if (!slot)
+		return NULL;
+	so_ht_node_t *dummy = atomic_load_explicit(slot, memory_order_acquire);
+	if (dummy)
+		return dummy;
+	so_ht_node_t *parent = bucket_init(ht, parent_of(b));
+	if (!parent || !(dummy = calloc(1, sizeof(so_ht_node_t))))
+		return NULL;
+	dummy->so_key = so_dummy(b);
+	_Atomic(uintptr_t) *prev;
+	so_ht_node_t *curr;
+	for (;;)
+	{
+		if (list_find(parent, dummy->so_key, NULL, 0, 0, &prev, &curr))
+		{
+			free(dummy);
+			dummy = curr;
+			break;
+		}
+		uintptr_t expected = (uintptr_t)curr;
+		atomic_store_explicit(&dummy->next, expected, memory_order_relaxed);
+		if (atomic_compare_exchange_strong_explicit(prev, &expected, (uintptr_t)dummy,
+			memory_order_release, memory_order_relaxed))
+			break;
+	}
+	atomic_store_explicit(slot, dummy, memory_order_release);
+	return dummy;
+}
+
+// closest initialized dummy at or before b's: any ancestor's precedes
+// all of b's entries, bucket 0's always exists. Never allocates
+static so_ht_node_t	*bucket_start(hashtable_t *ht, size_t b)
+{
+	for (;;)
+	{
+		so_bucket_t *slot = bucket_slot(ht, b, 0);
+		so_ht_node_t *dummy = slot ? atomic_load_explicit(slot, memory_order_acquire) : NULL;
+		if (dummy)
+			return dummy;
+		b = parent_of(b);
+	}
+}
+
+static inline size_t	bucket_of(hashtable_t *ht, uint64_t h)
+{
+	return h & (atomic_load_explicit(&ht->size, memory_order_relaxed) - 1);
+}
+
+// ============== Table ==============
+
+hashtable_t	*ht_create(size_t size)
+{
+	return ht_create_ex(size, 0);
+}
+
+// use pow-of-2 size to use bitwise AND in hash --> much better performance.
+// The directory segments for the initial size are allocated here, their
+// buckets are still initialized on first use
+hashtable_t	*ht_create_ex(size_t size, int flags)
+{
+	hashtable_t	*ht = calloc(1, sizeof(hashtable_t));
+	if (!ht) return NULL;
+	size_t actual_size = 1;
+	while (actual_size < size && actual_size < SO_MAX_BUCKETS) actual_size <<= 1;
+	ht->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	for (int s = 0; seg_base(s) < actual_size; s++)
+	{
+		if (!bucket_slot(ht, seg_base(s), 1))
+			return (ht_destroy(ht), NULL);
+		if (ht->seg_flags[s] & HT_HUGEPAGE)
+			ht->flags = ht->seg_flags[s];	// one fallback is enough to clear HUGETLB
+	}
+	if (!(ht->head = calloc(1, sizeof(so_ht_node_t))))
+		return (ht_destroy(ht), NULL);
+	atomic_store_explicit(&ht->segments[0][0], ht->head, memory_order_relaxed);
+	atomic_init(&ht->size, actual_size);
+	atomic_init(&ht->count, 0);
+	ht->hash_f = &wyhash;
+	return ht;
+}
+
+static so_ht_node_t	*node_create(const void *key, size_t len, uint64_t h, void *value)
+{
+	so_ht_node_t *node = malloc(sizeof(so_ht_node_t));
+	if (!node)
+		return NULL;
+	if (!ht_key_set(&node->key, key, len, h))
+		return (free(node), NULL);
+	node->so_key = so_regular(h);
+	atomic_init(&node->value, value);
+	return node;
+}
+
+// one more entry; past the load factor the bucket count doubles with one
+// CAS, nothing moves, the new buckets fill in as they're used
+static inline void	count_inc(hashtable_t *ht)
+{
+	long count = atomic_fetch_add_explicit(&ht->count, 1, memory_order_relaxed) + 1;
+	size_t size = atomic_load_explicit(&ht->size, memory_order_relaxed);
+	if (count > (long)(size * SO_MAX_LOAD) && size < SO_MAX_BUCKETS)
+		atomic_compare_exchange_strong_explicit(&ht->size, &size, size << 1,
+			memory_order_relaxed, memory_order_relaxed);
+}
+
+// same as lf_ht: links a new node in front of the first greater one,
+// updates if key exists and retires the replaced value once out of the
+// read-side section. Without memory for the bucket's dummy we start at an
+// ancestor's, just longer
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
+{
+	uint64_t h = ht->hash_f(key, len);
+	uint64_t so_key = so_regular(h);
+	_Atomic(uintptr_t) *prev;
+	so_ht_node_t *curr;
+	so_ht_node_t *node = NULL;		// allocated once we know it's an insert
+
+	rcu_read_lock();
+	size_t b = bucket_of(ht, h);
+	so_ht_node_t *start = bucket_init(ht, b);
+	if (!start)
+		start = bucket_start(ht, b);
+	for (;;)
+	{
+		// update
+		if (list_find(start, so_key, key, len, h, &prev, &curr))
+		{
+			void *old = atomic_exchange_explicit(&curr->value, value, memory_order_acq_rel);
+			rcu_read_unlock();
+			ht_retire_value(old);
+			if (node)
+				ht_key_free(&node->key);
+			return free(node);
+		}
+		if (!node && !(node = node_create(key, len, h, value)))
+			return (rcu_read_unlock(), free(value));
+		// insert: publish the node with one CAS, release makes it whole
+		uintptr_t expected = (uintptr_t)curr;
+		atomic_store_explicit(&node->next, expected, memory_order_relaxed);
+		if (atomic_compare_exchange_strong_explicit(prev, &expected, (uintptr_t)node,
+			memory_order_release, memory_order_relaxed))
+			break;
+	}
+	rcu_read_unlock();
+	count_inc(ht);
+}
+
+// wait-free traversal from the closest initialized dummy: marked nodes
+// are skipped, not unlinked, and a lookup never initializes a bucket
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	uint64_t h = ht->hash_f(key, len);
+	uint64_t so_key = so_regular(h);
+	void	*result = NULL;
+
+	rcu_read_lock();
+	so_ht_node_t *start = bucket_start(ht, bucket_of(ht, h));
+	uintptr_t curr = atomic_load_explicit(&start->next, memory_order_acquire);
+	while (curr)
+	{
+		so_ht_node_t *node = NODE(curr);
+		uintptr_t next = atomic_load_explicit(&node->next, memory_order_acquire);
+		int cmp = node_cmp(node, so_key, key, len, h);
+		if (cmp > 0)
+			break;
+		if (cmp == 0 && !(next & MARK))
+		{
+			result = atomic_load_explicit(&node->value, memory_order_acquire);
+			break;
+		}
+		curr = next;
+	}
+	rcu_read_unlock();
+	return result;
+}
+
+// marking is the linearization point; whoever unlinks the node retires it
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	uint64_t h = ht->hash_f(key, len);
+	uint64_t so_key = so_regular(h);
+	_Atomic(uintptr_t) *prev;
+	so_ht_node_t *curr;
+
+	rcu_read_lock();
+	size_t b = bucket_of(ht, h);
+	so_ht_node_t *start = bucket_init(ht, b);
+	if (!start)
+		start = bucket_start(ht, b);
+	while (list_find(start, so_key, key, len, h, &prev, &curr))
+	{
+		uintptr_t next = atomic_load_explicit(&curr->next, memory_order_acquire);
+		if (next & MARK)
+			continue;		// lost to another delete, find unlinks it
+		if (!atomic_compare_exchange_strong_explicit(&curr->next, &next, next | MARK,
+			memory_order_acq_rel, memory_order_relaxed))
+			continue;
+		atomic_fetch_sub_explicit(&ht->count, 1, memory_order_relaxed);
+		uintptr_t expected = (uintptr_t)curr;
+		if (atomic_compare_exchange_strong_explicit(prev, &expected, next,
+			memory_order_acq_rel, memory_order_relaxed))
+			call_rcu(&curr->rcu, free_node_callback);
+		else
+			list_find(start, so_key, key, len, h, &prev, &curr);
+		break;
+	}
+	rcu_read_unlock();
+}
+
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
+}
+
+// no concurrent users left: one walk frees every node, dummies and
+// marked ones included, then the directory
+void	ht_destroy(hashtable_t *ht)
+{
+	if (!ht) return;
+	uintptr_t curr = (uintptr_t)ht->head;
+	while (curr)
+	{
+		so_ht_node_t *node = NODE(curr);
+		curr = atomic_load_explicit(&node->next, memory_order_relaxed);
+		ht_key_free(&node->key);
+		free(atomic_load_explicit(&node->value, memory_order_relaxed));
+		free(node);
+	}
+	for (int s = 0; s < SO_SEGMENTS; s++)
+		ht_free(atomic_load_explicit(&ht->segments[s], memory_order_relaxed),
+			seg_bytes(s), ht->seg_flags[s]);
+	free(ht);
+}
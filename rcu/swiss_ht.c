@@ -0,0 +1,283 @@
+#include "swiss_ht.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CTRL_EMPTY		((int8_t)-128)
+#define CTRL_DELETED	((int8_t)-2)
+
+// group of control bytes, bit i of a match is slot pos + i
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define GROUP_WIDTH	32
+
+typedef __m256i	t_group;
+
+static inline t_group	group_load(const int8_t *ctrl)
+{
+	return _mm256_loadu_si256((const __m256i *)ctrl);
+}
+
+static inline uint32_t	group_match(t_group g, int8_t c)
+{
+	return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8(c)));
+}
+
+// empty or deleted: the sign bit
+static inline uint32_t	group_match_free(t_group g)
+{
+	return (uint32_t)_mm256_movemask_epi8(g);
+}
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define GROUP_WIDTH	16
+
+typedef __m128i	t_group;
+
+static inline t_group	group_load(const int8_t *ctrl)
+{
+	return _mm_loadu_si128((const __m128i *)ctrl);
+}
+
+static inline uint32_t	group_match(t_group g, int8_t c)
+{
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+}
+
+static inline uint32_t	group_match_free(t_group g)
+{
+	return (uint32_t)_mm_movemask_epi8(g);
+}
+#else
+# define GROUP_WIDTH	16
+
+typedef const int8_t	*t_group;
+
+static inline t_group	group_load(const int8_t *ctrl)
+{
+	return ctrl;
+}
+
+static inline uint32_t	group_match(t_group g, int8_t c)
+{
+	uint32_t	m = 0;
+	for (int i = 0; i < GROUP_WIDTH; i++)
+		m |= (uint32_t)(g[i] == c) << i;
+	return m;
+}
+
+static inline uint32_t	group_match_free(t_group g)
+{
+	uint32_t	m = 0;
+	for (int i = 0; i < GROUP_WIDTH; i++)
+		m |= (uint32_t)(g[i] < 0) << i;
+	return m;
+}
+#endif
+
+// high bits pick the group, the low 7 go in the control byte
+static inline int8_t	hash_tag(uint64_t h)
+{
+	return (int8_t)(h & 0x7f);
+}
+
+// 7/8 max load
+static inline size_t	capacity_growth(size_t size)
+{
+	return size - size / 8;
+}
+
+// the first group's bytes are mirrored past the end so a group load
+// starting anywhere reads GROUP_WIDTH valid bytes
+static inline void	set_ctrl(hashtable_t *ht, size_t i, int8_t c)
+{
+	ht->ctrl[i] = c;
+	if (i < GROUP_WIDTH)
+		ht->ctrl[ht->size + i] = c;
+}
+
+// triangular steps over groups visit every slot of a pow-of-2 table
+static inline size_t	find_slot(hashtable_t *ht, const void *key, size_t len, uint64_t h)
+{
+	int8_t	tag = hash_tag(h);
+	size_t	pos = (h >> 7) & ht->mask;
+
+	// most keys sit at their home slot: fetch it alongside the control bytes
+	__builtin_prefetch(&ht->slots[pos], 0, 1);
+	for (size_t step = 0; step <= ht->size; )
+	{
+		t_group g = group_load(ht->ctrl + pos);
+		for (uint32_t m = group_match(g, tag); m; m &= m - 1)
+		{
+			size_t i = (pos + __builtin_ctz(m)) & ht->mask;
+			if (ht_key_eq(&ht->slots[i].key, key, len, h))
+				return i;
+		}
+		if (group_match(g, CTRL_EMPTY))
+			return SIZE_MAX;
+		step += GROUP_WIDTH;
+		pos = (pos + step) & ht->mask;
+	}
+	return SIZE_MAX;
+}
+
+// first empty or deleted slot on the key's probe sequence; there always is
+// one, the load is capped below 1
+static inline size_t	find_free(hashtable_t *ht, uint64_t h)
+{
+	size_t	pos = (h >> 7) & ht->mask;
+
+	for (size_t step = 0; ; )
+	{
+		uint32_t m = group_match_free(group_load(ht->ctrl + pos));
+		if (m)
+			return (pos + __builtin_ctz(m)) & ht->mask;
+		step += GROUP_WIDTH;
+		pos = (pos + step) & ht->mask;
+	}
+}
+
+static int	table_alloc(hashtable_t *ht, size_t size, int flags)
+{
+	ht->flags = (flags & HT_HUGEPAGE) ? HT_HUGEPAGE | HT_HUGETLB : 0;
+	ht->ctrl = ht_alloc(size + GROUP_WIDTH, &ht->flags);
+	if (!ht->ctrl)
+		return 0;
+	ht->slots = ht_alloc(size * sizeof(swiss_slot_t), &ht->flags);
+	if (!ht->slots)
+		return (ht_free(ht->ctrl, size + GROUP_WIDTH, ht->flags), 0);
+	memset(ht->ctrl, CTRL_EMPTY, size + GROUP_WIDTH);
+	ht->size = size;
+	ht->mask = size - 1;
+	ht->count = 0;
+	ht->growth_left = capacity_growth(size);
+	return 1;
+}
+
+static void	table_free(int8_t *ctrl, swiss_slot_t *slots, size_t size, int flags)
+{
+	ht_free(ctrl, size + GROUP_WIDTH, flags);
+	ht_free(slots, size * sizeof(swiss_slot_t), flags);
+}
+
+// reinserts everything into a fresh array: twice the size, or the same
+// size if mostly tombstones made us run out of empty slots
+static int	rehash(hashtable_t *ht)
+{
+	hashtable_t	old = *ht;
+	size_t	size = ht->count >= capacity_growth(ht->size) / 2 ? ht->size * 2 : ht->size;
+
+	if (!table_alloc(ht, size, old.flags))
+		return (*ht = old, 0);
+	for (size_t i = 0; i < old.size; i++)
+	{
+		if (old.ctrl[i] < 0)
+			continue;
+		uint64_t h = old.slots[i].key.hash;
+		size_t j = find_free(ht, h);
+		set_ctrl(ht, j, hash_tag(h));
+		ht->slots[j] = old.slots[i];
+	}
+	ht->count = old.count;
+	ht->growth_left -= old.count;
+	table_free(old.ctrl, old.slots, old.size, old.flags);
+	return 1;
+}
+
+hashtable_t	*ht_create(size_t size)
+{
+	return ht_create_ex(size, 0);
+}
+
+// use pow-of-2 size to use bitwise AND in hash --> much better performance
+hashtable_t	*ht_create_ex(size_t size, int flags)
+{
+	hashtable_t	*ht = malloc(sizeof(hashtable_t));
+	if (!ht) return NULL;
+	size_t actual_size = GROUP_WIDTH;
+	while (actual_size < size) actual_size <<= 1;
+	ht->hash_f = &wyhash;
+	if (!table_alloc(ht, actual_size, flags))
+		return (free(ht), NULL);
+	return ht;
+}
+
+// updates in place if key exists, else takes the first free slot
+void	ht_insert_bytes(hashtable_t *ht, const void *key, size_t len, void *value)
+{
+	uint64_t h = ht->hash_f(key, len);
+	size_t i = find_slot(ht, key, len, h);
+
+	// update
+	if (i != SIZE_MAX)
+	{
+		free(ht->slots[i].value);
+		ht->slots[i].value = value;
+		return;
+	}
+
+	// insert: a tombstone can be reused for free, an empty slot costs growth
+	i = find_free(ht, h);
+	if (ht->ctrl[i] == CTRL_EMPTY && !ht->growth_left)
+	{
+		if (!rehash(ht))
+			return free(value);
+		i = find_free(ht, h);
+	}
+	if (!ht_key_set(&ht->slots[i].key, key, len, h))
+		return free(value);
+	ht->growth_left -= ht->ctrl[i] == CTRL_EMPTY;
+	set_ctrl(ht, i, hash_tag(h));
+	ht->slots[i].value = value;
+	ht->count++;
+}
+
+// probes group by group; null if not found
+inline void	*ht_lookup_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	size_t i = find_slot(ht, key, len, ht->hash_f(key, len));
+
+	return i == SIZE_MAX ? NULL : ht->slots[i].value;
+}
+
+// leaves a tombstone: later keys may have probed past this slot
+void	ht_delete_bytes(hashtable_t *ht, const void *key, size_t len)
+{
+	size_t i = find_slot(ht, key, len, ht->hash_f(key, len));
+
+	if (i == SIZE_MAX)
+		return;
+	ht_key_free(&ht->slots[i].key);
+	free(ht->slots[i].value);
+	set_ctrl(ht, i, CTRL_DELETED);
+	ht->count--;
+}
+
+void	ht_insert(hashtable_t *ht, int key, void *value)
+{
+	ht_insert_bytes(ht, &key, sizeof(key), value);
+}
+
+void	*ht_lookup(hashtable_t *ht, int key)
+{
+	return ht_lookup_bytes(ht, &key, sizeof(key));
+}
+
+void	ht_delete(hashtable_t *ht, int key)
+{
+	ht_delete_bytes(ht, &key, sizeof(key));
+}
+
+// standard for malloc'd values
+void	ht_destroy(hashtable_t *ht)
+{
+	if (!ht) return;
+	for (size_t i = 0; i < ht->size; i++)
+	{
+		if (ht->ctrl[i] < 0)
+			continue;
+		ht_key_free(&ht->slots[i].key);
+		free(ht->slots[i].value);
+	}
+	table_free(ht->ctrl, ht->slots, ht->size, ht->flags);
+	free(ht);
+}
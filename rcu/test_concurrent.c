@@ -4,6 +4,15 @@
 #include "rw_ht.h"
 #elif defined(RCU_HASHTABLE)
 #include "rcu_ht.h"
+#elif defined(LF_HASHTABLE)
+#include "lf_ht.h"
+#elif defined(SO_HASHTABLE)
+#include "so_ht.h"
+#endif
+
+// threads touching these must be registered with urcu
+#if defined(RCU_HASHTABLE) || defined(LF_HASHTABLE) || defined(SO_HASHTABLE)
+#define HT_USES_URCU
 #endif
 
 #include <stdlib.h>
@@ -61,6 +70,133 @@ int test_rwlock_contention() {
 	return 1;
 }
 
+#if defined(LF_HASHTABLE) || defined(SO_HASHTABLE)
+// Each thread owns keys t, t + STRESS_THREADS, ... but all of them share
+// a few buckets, so CAS races on the same links are constant (split-ordered
+// also grows and initializes buckets meanwhile). A thread can check its
+// own keys exactly: nobody else inserts or deletes them
+#define STRESS_THREADS 4
+#define STRESS_KEYS 2000
+#define STRESS_ROUNDS 50
+
+typedef struct {
+    hashtable_t *ht;
+    int id;
+    int errors;
+} stress_args_t;
+
+void *lf_stress_thread(void *arg) {
+    stress_args_t *args = (stress_args_t *)arg;
+    rcu_register_thread();
+    for (int round = 0; round < STRESS_ROUNDS; round++) {
+        for (int k = args->id; k < STRESS_KEYS; k += STRESS_THREADS) {
+            int *val = malloc(sizeof(int));
+            *val = k + round;
+            ht_insert(args->ht, k, val);
+        }
+        for (int k = args->id; k < STRESS_KEYS; k += STRESS_THREADS) {
+            int *val = ht_lookup(args->ht, k);
+            if (!val || *val != k + round)
+                args->errors++;
+            if ((k / STRESS_THREADS + round) % 2)
+                ht_delete(args->ht, k);
+        }
+        for (int k = args->id; k < STRESS_KEYS; k += STRESS_THREADS) {
+            int gone = (k / STRESS_THREADS + round) % 2;
+            if ((ht_lookup(args->ht, k) == NULL) != gone)
+                args->errors++;
+        }
+    }
+    rcu_unregister_thread();
+    return NULL;
+}
+
+int test_lf_stress() {
+    hashtable_t *ht = ht_create(16);
+    pthread_t threads[STRESS_THREADS];
+    stress_args_t args[STRESS_THREADS];
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        args[i].ht = ht;
+        args[i].id = i;
+        args[i].errors = 0;
+        pthread_create(&threads[i], NULL, lf_stress_thread, &args[i]);
+    }
+    int errors = 0;
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    ht_destroy(ht);
+    printf("%s: Lock-free insert/delete stress (%d errors)\n", errors ? "FAIL" : "PASS", errors);
+    return !errors;
+}
+#endif
+
+#ifdef HT_USES_URCU
+// One writer keeps overwriting a few keys while readers dereference what
+// they find, inside their own read-side section: a replaced value must
+// stay valid until they leave it (ASan flags it otherwise)
+#define UPDATE_KEYS 64
+#define UPDATE_ROUNDS 2000
+#define UPDATE_READERS 3
+
+typedef struct {
+    hashtable_t *ht;
+    int *done;
+    int errors;
+} update_args_t;
+
+void *update_reader(void *arg) {
+    update_args_t *args = (update_args_t *)arg;
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    rcu_register_thread();
+    while (!__atomic_load_n(args->done, __ATOMIC_ACQUIRE)) {
+        int key = rand_r(&seed) % UPDATE_KEYS;
+        rcu_read_lock();
+        int *val = ht_lookup(args->ht, key);
+        if (!val || *val % UPDATE_KEYS != key)
+            args->errors++;
+        rcu_read_unlock();
+    }
+    rcu_unregister_thread();
+    return NULL;
+}
+
+int test_update_readers() {
+    hashtable_t *ht = ht_create(16);
+    int done = 0;
+    for (int k = 0; k < UPDATE_KEYS; k++) {
+        int *val = malloc(sizeof(int));
+        *val = k;
+        ht_insert(ht, k, val);
+    }
+    pthread_t threads[UPDATE_READERS];
+    update_args_t args[UPDATE_READERS];
+    for (int i = 0; i < UPDATE_READERS; i++) {
+        args[i].ht = ht;
+        args[i].done = &done;
+        args[i].errors = 0;
+        pthread_create(&threads[i], NULL, update_reader, &args[i]);
+    }
+    for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+        for (int k = 0; k < UPDATE_KEYS; k++) {
+            int *val = malloc(sizeof(int));
+            *val = round * UPDATE_KEYS + k;
+            ht_insert(ht, k, val);
+        }
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    int errors = 0;
+    for (int i = 0; i < UPDATE_READERS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    ht_destroy(ht);
+    printf("%s: Updates under readers (%d errors)\n", errors ? "FAIL" : "PASS", errors);
+    return !errors;
+}
+#endif
+
 typedef struct {
     hashtable_t *ht;
     long long *ops_done; // Shared counter for throughput calculation
@@ -80,6 +216,9 @@ uint64_t get_monotonic_time_us(void) {
 void *benchmark_worker(void *arg) {
     bench_args_t *args = (bench_args_t *)arg;
     long long local_ops = 0;
+#ifdef HT_USES_URCU
+    rcu_register_thread();
+#endif
     uint64_t start_time = get_monotonic_time_us(); // You need a monotonic clock
 
     while ((get_monotonic_time_us() - start_time) < args->duration_us) {
@@ -96,6 +235,9 @@ void *benchmark_worker(void *arg) {
         local_ops++;
     }
     __sync_fetch_and_add(args->ops_done, local_ops); // Atomic add to shared counter
+#ifdef HT_USES_URCU
+    rcu_unregister_thread();
+#endif
     return NULL;
 }
 
@@ -140,24 +282,173 @@ void run_scaling_benchmark(int table_size, int key_range, int read_percent) {
     ht_destroy(ht);
 }
 
+#if defined(RCU_HASHTABLE) || defined(SO_HASHTABLE)
+// Growth under readers: one writer inserts keys 0..GROW_KEYS-1 into a
+// table that starts at GROW_START buckets, readers look up keys already inserted and time
+// every lookup, binned per million keys inserted
+#define GROW_START 1024
+#define GROW_KEYS 10000000
+#define GROW_STEP 1000000
+#define GROW_PHASES (GROW_KEYS / GROW_STEP)
+#define GROW_READERS 2
+#define LAT_BINS (64 * 8)
+
+typedef struct {
+    hashtable_t *ht;
+    long *inserted;    // keys below this are in the table
+    int *done;
+    unsigned seed;
+    uint64_t lat[GROW_PHASES][LAT_BINS];
+    uint64_t max_ns[GROW_PHASES];
+    long misses;
+} grow_args_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// log2 bins with 8 linear sub-bins each
+static int lat_bin(uint64_t ns) {
+    if (ns < 8)
+        return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    return msb * 8 + (int)((ns >> (msb - 3)) & 7);
+}
+
+static uint64_t lat_value(int bin) {
+    if (bin < 8)
+        return bin;
+    int msb = bin / 8;
+    return ((uint64_t)(8 + bin % 8)) << (msb - 3);
+}
+
+static uint64_t lat_percentile(const uint64_t *bins, uint64_t total, double p) {
+    uint64_t rank = (uint64_t)(total * p), seen = 0;
+    for (int i = 0; i < LAT_BINS; i++) {
+        seen += bins[i];
+        if (seen > rank)
+            return lat_value(i);
+    }
+    return lat_value(LAT_BINS - 1);
+}
+
+void *grow_reader(void *arg) {
+    grow_args_t *args = (grow_args_t *)arg;
+    rcu_register_thread();
+    while (!__atomic_load_n(args->done, __ATOMIC_ACQUIRE)) {
+        long n = __atomic_load_n(args->inserted, __ATOMIC_ACQUIRE);
+        if (!n)
+            continue;
+        int key = (int)(rand_r(&args->seed) % n);
+        int phase = (int)(n / GROW_STEP);
+        if (phase >= GROW_PHASES)
+            phase = GROW_PHASES - 1;
+        uint64_t t0 = now_ns();
+        void *val = ht_lookup(args->ht, key);
+        uint64_t dt = now_ns() - t0;
+        if (!val)
+            args->misses++;
+        args->lat[phase][lat_bin(dt)]++;
+        if (dt > args->max_ns[phase])
+            args->max_ns[phase] = dt;
+    }
+    rcu_unregister_thread();
+    return NULL;
+}
+
+void run_growth_benchmark(void) {
+    printf("\n=== Growth: %d buckets -> %d keys, %d readers ===\n",
+           GROW_START, GROW_KEYS, GROW_READERS);
+    hashtable_t *ht = ht_create(GROW_START);
+    long inserted = 0;
+    int done = 0;
+    grow_args_t *args = calloc(GROW_READERS, sizeof(grow_args_t));
+    pthread_t threads[GROW_READERS];
+    if (!ht || !args)
+        return (void)(ht_destroy(ht), free(args));
+
+    for (int i = 0; i < GROW_READERS; i++) {
+        args[i].ht = ht;
+        args[i].inserted = &inserted;
+        args[i].done = &done;
+        args[i].seed = i + 1;
+        pthread_create(&threads[i], NULL, grow_reader, &args[i]);
+    }
+    uint64_t start = now_ns();
+    uint64_t phase_ns[GROW_PHASES];
+    size_t phase_size[GROW_PHASES];
+    for (int i = 0; i < GROW_KEYS; i++) {
+        int *val = malloc(sizeof(int));
+        *val = i;
+        ht_insert(ht, i, val);
+        __atomic_store_n(&inserted, i + 1, __ATOMIC_RELEASE);
+        if ((i + 1) % GROW_STEP == 0) {
+            phase_ns[i / GROW_STEP] = now_ns() - start;
+            phase_size[i / GROW_STEP] = ht->size;
+        }
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < GROW_READERS; i++)
+        pthread_join(threads[i], NULL);
+
+    long misses = 0;
+    printf("Keys    | Buckets  | Insert s | Lookups   | p50 ns | p99 ns | p99.9 ns | max ns\n");
+    printf("--------|----------|----------|-----------|--------|--------|----------|--------\n");
+    for (int p = 0; p < GROW_PHASES; p++) {
+        uint64_t bins[LAT_BINS] = {0}, total = 0, max_ns = 0;
+        for (int i = 0; i < GROW_READERS; i++) {
+            for (int b = 0; b < LAT_BINS; b++)
+                bins[b] += args[i].lat[p][b];
+            if (args[i].max_ns[p] > max_ns)
+                max_ns = args[i].max_ns[p];
+        }
+        for (int b = 0; b < LAT_BINS; b++)
+            total += bins[b];
+        printf("%5dM  | %8zu | %8.2f | %9lu | %6lu | %6lu | %8lu | %lu\n",
+               (p + 1) * GROW_STEP / 1000000, phase_size[p], phase_ns[p] / 1e9,
+               (unsigned long)total,
+               (unsigned long)lat_percentile(bins, total, 0.50),
+               (unsigned long)lat_percentile(bins, total, 0.99),
+               (unsigned long)lat_percentile(bins, total, 0.999),
+               (unsigned long)max_ns);
+    }
+    for (int i = 0; i < GROW_READERS; i++)
+        misses += args[i].misses;
+    printf("Inserted keys not found: %ld\n", misses);
+    free(args);
+    ht_destroy(ht);
+}
+#endif
+
 int main()
 {
-#ifdef RCU_HASHTABLE
+#ifdef HT_USES_URCU
     rcu_register_thread();
 #endif
 #ifdef RWLOCK_HASHTABLE
 	test_rwlock_contention();
+#endif
+#if defined(LF_HASHTABLE) || defined(SO_HASHTABLE)
+    test_lf_stress();
+#endif
+#ifdef HT_USES_URCU
+    test_update_readers();
 #endif
 	// Test in-cache (1K keys) and out-of-cache (100K keys) scenarios
     size_t key_counts[] = {1000, 100000};
-    int read_ratios[] = {50, 90, 95, 99};
+    int read_ratios[] = {0, 10, 50, 90, 95, 99};  // write-heavy first
 
     for (int k = 0; k < 2; k++) {
-        for (int r = 0; r < 4; r++) {
+        for (size_t r = 0; r < sizeof(read_ratios)/sizeof(read_ratios[0]); r++) {
             run_scaling_benchmark(4096, key_counts[k], read_ratios[r]);
         }
     }
-#ifdef RCU_HASHTABLE
+#if defined(RCU_HASHTABLE) || defined(SO_HASHTABLE)
+    run_growth_benchmark();
+#endif
+#ifdef HT_USES_URCU
     rcu_unregister_thread();
 #endif
 	return 0;
@@ -6,6 +6,12 @@
 #include "rw_ht.h"
 #elif defined(RCU_HASHTABLE)
 #include "rcu_ht.h"
+#elif defined(SWISS_HASHTABLE)
+#include "swiss_ht.h"
+#elif defined(LF_HASHTABLE)
+#include "lf_ht.h"
+#elif defined(SO_HASHTABLE)
+#include "so_ht.h"
 #endif
 
 #include <stdio.h>
@@ -15,6 +21,10 @@
 #include <time.h>
 #include <limits.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #define TEST_ASSERT(cond, msg) \
     do { \
@@ -570,6 +580,69 @@ int test_memory_boundaries() {
     return 1;
 }
 
+int test_byte_keys() {
+    printf("\n=== Test 11: Byte Keys ===\n");
+    hashtable_t *ht = ht_create(16);
+    
+    // Short keys stay inline, long ones are allocated
+    const char *keys[] = {"", "a", "ab", "abc", "user:1", "0123456789abcdef",
+                          "0123456789abcdefg", "session:7f3a9c1e2b4d",
+                          "a/fairly/long/path/that/goes/past/forty/eight/bytes/x"};
+    int n = sizeof(keys) / sizeof(keys[0]);
+    for (int i = 0; i < n; i++) {
+        int *val = malloc(sizeof(int));
+        *val = i;
+        ht_insert_bytes(ht, keys[i], strlen(keys[i]), val);
+    }
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        int *val = ht_lookup_bytes(ht, keys[i], strlen(keys[i]));
+        if (!val || *val != i)
+            ok = 0;
+    }
+    TEST_ASSERT(ok, "Keys of 0 to 53 bytes are retrievable");
+    
+    // Same bytes, different length, and a last-byte difference
+    TEST_ASSERT(ht_lookup_bytes(ht, "abcd", 4) == NULL, "Longer key with a stored prefix misses");
+    TEST_ASSERT(ht_lookup_bytes(ht, "session:7f3a9c1e2b4e", 20) == NULL, "Last byte differs misses");
+    TEST_ASSERT(ht_lookup_bytes(ht, "user:1", 5) == NULL, "Shorter key misses");
+    
+    // Embedded zeros and 64-bit ids are plain bytes
+    char zeros[8] = {'k', 0, 0, 'v'};
+    uint64_t id = 0x123456789abcdefULL;
+    int *zval = malloc(sizeof(int)), *idval = malloc(sizeof(int));
+    *zval = 100;
+    *idval = 200;
+    ht_insert_bytes(ht, zeros, sizeof(zeros), zval);
+    ht_insert_bytes(ht, &id, sizeof(id), idval);
+    int *found = ht_lookup_bytes(ht, zeros, sizeof(zeros));
+    TEST_ASSERT(found && *found == 100, "Key with embedded zeros works");
+    found = ht_lookup_bytes(ht, &id, sizeof(id));
+    TEST_ASSERT(found && *found == 200, "64-bit id key works");
+    
+    // Update and delete a long key
+    const char *lk = keys[n - 1];
+    int *upd = malloc(sizeof(int));
+    *upd = 999;
+    ht_insert_bytes(ht, lk, strlen(lk), upd);
+    found = ht_lookup_bytes(ht, lk, strlen(lk));
+    TEST_ASSERT(found && *found == 999, "Long key update works");
+    ht_delete_bytes(ht, lk, strlen(lk));
+    TEST_ASSERT(ht_lookup_bytes(ht, lk, strlen(lk)) == NULL, "Long key delete works");
+    found = ht_lookup_bytes(ht, keys[n - 2], strlen(keys[n - 2]));
+    TEST_ASSERT(found && *found == n - 2, "Other keys survive the delete");
+    
+    // int keys are their 4 bytes
+    int ikey = 42;
+    int *ival = malloc(sizeof(int));
+    *ival = 42;
+    ht_insert(ht, ikey, ival);
+    TEST_ASSERT(ht_lookup_bytes(ht, &ikey, sizeof(ikey)) == ival, "int key is its 4 bytes");
+    
+    ht_destroy(ht);
+    return 1;
+}
+
 // Measure memory bandwidth
 int benchmark_memory_bandwidth() {
     const size_t SIZE = 1000000;
@@ -608,6 +681,7 @@ int benchmark_cache_effects() {
     size_t sizes[] = {1024, 4096, 32768, 131072, 524288, 2097152, 8388608};
     //                L1     L1      L2      L2       L3       L3       DRAM
     
+    printf("Keys     (array KB) | array Mops | table Mops\n");
     for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
         size_t N = sizes[s];
         int *data = malloc(N * sizeof(int));
@@ -625,8 +699,22 @@ int benchmark_cache_effects() {
         }
         double time = (double)(clock() - start) / CLOCKS_PER_SEC;
         
-        printf("Size %8zu (%4zuKB): %.2f Mops/sec\n", 
-               N, N*sizeof(int)/1024, 1.0/time);
+        // Same number of random hits on a table holding N keys
+        hashtable_t *ht = ht_create(N);
+        for (size_t i = 0; i < N; i++) {
+            ht_insert(ht, (int)i, NULL);
+        }
+        start = clock();
+        volatile void *sink;
+        for (int i = 0; i < 1000000; i++) {
+            sink = ht_lookup(ht, rand() % N);
+        }
+        (void)sink;
+        double ht_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+        ht_destroy(ht);
+        
+        printf("%8zu (%6zuKB) | %10.2f | %10.2f\n", 
+               N, N*sizeof(int)/1024, 1.0/time, 1.0/ht_time);
         
         free(data);
     }
@@ -665,6 +753,125 @@ int benchmark_cache_aware_vs_oblivious() {
 	return 1;
 }
 
+// dTLB load misses of this thread, user space only; -1 if no PMU access
+static int dtlb_counter_open(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// random lookups, misses only touch the bucket array (and locks)
+static void run_hugepage_lookups(int flags, int keys, int lookups) {
+    hashtable_t *ht = ht_create_ex(keys * 2, flags);
+    for (int i = 0; i < keys; i++) {
+        int *val = malloc(sizeof(int));
+        *val = i;
+        ht_insert(ht, i, val);
+    }
+    unsigned int seed = 42;
+    double rates[2];
+    long long misses[2] = {-1, -1};
+    for (int pass = 0; pass < 2; pass++) {  // 0: hits, 1: misses
+        int fd = dtlb_counter_open();
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        volatile void *sink;
+        double start = now_sec();
+        for (int i = 0; i < lookups; i++)
+            sink = ht_lookup(ht, rand_r(&seed) % keys + pass * keys);
+        (void)sink;
+        rates[pass] = lookups / (now_sec() - start) / 1e6;
+        if (fd >= 0) {
+            if (read(fd, &misses[pass], sizeof(long long)) != sizeof(long long))
+                misses[pass] = -1;
+            close(fd);
+        }
+    }
+    const char *label = !flags ? "4 KiB pages"
+        : (ht->flags & HT_HUGETLB) ? "MAP_HUGETLB" : "MADV_HUGEPAGE";
+    char hit_tlb[32] = "n/a", miss_tlb[32] = "n/a";
+    if (misses[0] >= 0)
+        snprintf(hit_tlb, sizeof(hit_tlb), "%.3f", (double)misses[0] / lookups);
+    if (misses[1] >= 0)
+        snprintf(miss_tlb, sizeof(miss_tlb), "%.3f", (double)misses[1] / lookups);
+    printf("%-14s | %8.2f | %8s | %8.2f | %8s\n", label, rates[0], hit_tlb, rates[1], miss_tlb);
+    ht_destroy(ht);
+}
+
+int benchmark_hugepage_lookup() {
+    const int keys = 1 << 20, lookups = 10000000;
+    printf("\n=== Huge Page Buckets (%d keys, %d buckets, %d lookups) ===\n",
+           keys, keys * 2, lookups);
+    printf("Buckets        | hit Mops | dTLB/op  | miss Mops| dTLB/op\n");
+    printf("---------------|----------|----------|----------|---------\n");
+    run_hugepage_lookups(0, keys, lookups);
+    run_hugepage_lookups(HT_HUGEPAGE, keys, lookups);
+    return 1;
+}
+
+// key lengths drawn from [min, max], random bytes; 64-bit ids are 8..8
+static void run_byte_key_lookups(const char *label, int min_len, int max_len, int keys) {
+    const int lookups = 2000000;
+    unsigned int seed = 7;
+    size_t stride = max_len;
+    unsigned char *buf = malloc((size_t)keys * 2 * stride);
+    int *lens = malloc((size_t)keys * 2 * sizeof(int));
+    // second half: same length distribution, never inserted
+    for (int i = 0; i < keys * 2; i++) {
+        lens[i] = min_len + rand_r(&seed) % (max_len - min_len + 1);
+        for (int b = 0; b < lens[i]; b++)
+            buf[(size_t)i * stride + b] = rand_r(&seed);
+        memcpy(buf + (size_t)i * stride, &i, sizeof(int) < (size_t)lens[i] ? sizeof(int) : (size_t)lens[i]);
+    }
+    hashtable_t *ht = ht_create(keys);
+    double start = now_sec();
+    for (int i = 0; i < keys; i++)
+        ht_insert_bytes(ht, buf + (size_t)i * stride, lens[i], NULL);
+    double insert = keys / (now_sec() - start) / 1e6;
+    double rates[2];
+    for (int pass = 0; pass < 2; pass++) {  // 0: hits, 1: misses
+        volatile void *sink;
+        start = now_sec();
+        for (int i = 0; i < lookups; i++) {
+            int k = rand_r(&seed) % keys + pass * keys;
+            sink = ht_lookup_bytes(ht, buf + (size_t)k * stride, lens[k]);
+        }
+        (void)sink;
+        rates[pass] = lookups / (now_sec() - start) / 1e6;
+    }
+    printf("%-16s | %6d-%-3d | %10.2f | %8.2f | %9.2f\n", label, min_len, max_len, insert, rates[0], rates[1]);
+    ht_destroy(ht);
+    free(buf);
+    free(lens);
+}
+
+int benchmark_byte_keys() {
+    const int keys = 1 << 20;
+    printf("\n=== Byte Keys (%d keys, inline up to %d bytes) ===\n", keys, HT_KEY_INLINE);
+    printf("Keys             | len bytes  | insert Mops| hit Mops | miss Mops\n");
+    printf("-----------------|------------|------------|----------|----------\n");
+    run_byte_key_lookups("64-bit ids", 8, 8, keys);
+    run_byte_key_lookups("short strings", 8, 16, keys);
+    run_byte_key_lookups("mixed strings", 8, 64, keys);
+    run_byte_key_lookups("long strings", 33, 64, keys);
+    return 1;
+}
+
 // Main test runner
 int main() {
     int passed = 0;
@@ -683,9 +890,12 @@ int main() {
         test_edge_cases,
 		test_hash_function_edge_cases,
 		test_memory_boundaries,
+		test_byte_keys,
 		benchmark_memory_bandwidth,
 		benchmark_cache_effects,
 		benchmark_cache_aware_vs_oblivious,
+		benchmark_hugepage_lookup,
+		benchmark_byte_keys,
         NULL
     };
     
@@ -0,0 +1,179 @@
+#include "mcast_ring.h"
+#include <string.h>
+#include <stdint.h>
+
+static inline size_t roundup_pow2(size_t n)
+{
+	n--;
+	n |= n >> 1;
+	n |= n >> 2;
+	n |= n >> 4;
+	n |= n >> 8;
+	n |= n >> 16;
+	n |= n >> 32;
+	return n + 1;
+}
+
+t_mcast_ring *mcast_create(size_t size, size_t item_size, size_t max_consumers)
+{
+	if (!item_size || !max_consumers)
+		return NULL;
+	if (size < 2) size = 2;
+	size = roundup_pow2(size);
+	t_mcast_ring *r = aligned_alloc(64, sizeof(t_mcast_ring));
+	if (!r) return NULL;
+	r->consumers = aligned_alloc(64, max_consumers * sizeof(t_mcast_consumer));
+	r->buf = aligned_alloc(64, (size * item_size + 63) & ~(size_t)63);
+	if (!r->consumers || !r->buf)
+		return (free(r->consumers), free(r->buf), free(r), NULL);
+	atomic_init(&r->cursor, 0);
+	r->next = 0;
+	r->cached_gate = 0;
+	r->nconsumers = 0;
+	r->max_consumers = max_consumers;
+	r->size = size;
+	r->mask = size - 1;
+	r->item_size = item_size;
+	return r;
+}
+
+void mcast_destroy(t_mcast_ring *r)
+{
+	if (r)
+	{
+		free(r->consumers);
+		free(r->buf);
+		free(r);
+	}
+}
+
+int mcast_add_consumer(t_mcast_ring *r, const int *deps, size_t ndeps)
+{
+	if (r->nconsumers == r->max_consumers || ndeps > MCAST_MAX_DEPS)
+		return -1;
+	for (size_t i = 0; i < ndeps; i++)
+		if (deps[i] < 0 || (size_t)deps[i] >= r->nconsumers)
+			return -1;
+	int id = r->nconsumers++;
+	t_mcast_consumer *c = &r->consumers[id];
+	// starts at the current cursor, older entries may already be gone
+	size_t start = atomic_load_explicit(&r->cursor, memory_order_relaxed);
+	atomic_init(&c->seq, start);
+	c->local_seq = start;
+	c->cached_barrier = start;
+	c->ndeps = ndeps;
+	c->gating = true;
+	for (size_t i = 0; i < ndeps; i++)
+	{
+		c->deps[i] = deps[i];
+		r->consumers[deps[i]].gating = false;	// we trail it
+	}
+	return id;
+}
+
+// ============== Producer ==============
+
+static size_t slowest_gate(t_mcast_ring *r)
+{
+	size_t gate = r->next;
+	for (size_t i = 0; i < r->nconsumers; i++)
+	{
+		if (!r->consumers[i].gating)
+			continue;
+		size_t seq = atomic_load_explicit(&r->consumers[i].seq, memory_order_acquire);
+		if (seq < gate)
+			gate = seq;
+	}
+	return gate;
+}
+
+void *mcast_claim(t_mcast_ring *r, size_t n, size_t *got)
+{
+	size_t space = r->size - (r->next - r->cached_gate);
+	if (space < n)
+	{
+		r->cached_gate = slowest_gate(r);
+		space = r->size - (r->next - r->cached_gate);
+	}
+	size_t idx = r->next & r->mask;
+	size_t chunk = r->size - idx;		// up to the end of the buffer
+	if (n > space) n = space;
+	if (n > chunk) n = chunk;
+	*got = n;
+	return r->buf + idx * r->item_size;
+}
+
+void mcast_commit(t_mcast_ring *r, size_t n)
+{
+	r->next += n;
+	atomic_store_explicit(&r->cursor, r->next, memory_order_release);
+}
+
+size_t mcast_publish(t_mcast_ring *r, const void *items, size_t n)
+{
+	size_t done = 0, got;
+	while (done < n)	// at most twice, the second claim starts at 0
+	{
+		void *dst = mcast_claim(r, n - done, &got);
+		if (!got) break;
+		memcpy(dst, (const unsigned char *)items + done * r->item_size, got * r->item_size);
+		mcast_commit(r, got);
+		done += got;
+	}
+	return done;
+}
+
+// ============== Consumers ==============
+
+static size_t barrier(t_mcast_ring *r, t_mcast_consumer *c)
+{
+	if (!c->ndeps)
+		return atomic_load_explicit(&r->cursor, memory_order_acquire);
+	// deps never pass the cursor, their min is enough
+	size_t b = SIZE_MAX;
+	for (size_t i = 0; i < c->ndeps; i++)
+	{
+		size_t seq = atomic_load_explicit(&r->consumers[c->deps[i]].seq, memory_order_acquire);
+		if (seq < b)
+			b = seq;
+	}
+	return b;
+}
+
+const void *mcast_peek(t_mcast_ring *r, int id, size_t n, size_t *got)
+{
+	t_mcast_consumer *c = &r->consumers[id];
+	size_t avail = c->cached_barrier - c->local_seq;
+	if (avail < n)
+	{
+		c->cached_barrier = barrier(r, c);
+		avail = c->cached_barrier - c->local_seq;
+	}
+	size_t idx = c->local_seq & r->mask;
+	size_t chunk = r->size - idx;
+	if (n > avail) n = avail;
+	if (n > chunk) n = chunk;
+	*got = n;
+	return r->buf + idx * r->item_size;
+}
+
+void mcast_release(t_mcast_ring *r, int id, size_t n)
+{
+	t_mcast_consumer *c = &r->consumers[id];
+	c->local_seq += n;
+	atomic_store_explicit(&c->seq, c->local_seq, memory_order_release);
+}
+
+size_t mcast_consume(t_mcast_ring *r, int id, void *items, size_t n)
+{
+	size_t done = 0, got;
+	while (done < n)
+	{
+		const void *src = mcast_peek(r, id, n - done, &got);
+		if (!got) break;
+		memcpy((unsigned char *)items + done * r->item_size, src, got * r->item_size);
+		mcast_release(r, id, got);
+		done += got;
+	}
+	return done;
+}
@@ -0,0 +1,86 @@
+#ifndef MCAST_RING_H
+#define MCAST_RING_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+/*
+ * Single-producer multicast ring (Disruptor style): every consumer sees
+ * every entry. Entries are fixed size, nothing is copied per consumer.
+ *
+ * Sequences count entries and never wrap (size_t). The producer publishes
+ * `cursor`, each consumer publishes its own `seq` (entries it is done
+ * with). A consumer's barrier is the cursor, or the min of the consumers
+ * it depends on, which builds a pipeline: e.g. log and metrics read
+ * straight behind the producer, processing waits for both. The producer
+ * gates on the slowest consumer nobody depends on, anything upstream of
+ * it is necessarily ahead.
+ *
+ * Same layout as t_spsc_ring: each shared sequence on its own line, the
+ * cached remote values next to the side that owns them, reloaded only
+ * when the ring looks full / empty.
+ */
+
+# define MCAST_MAX_DEPS	4
+
+typedef struct mcast_consumer
+{
+	alignas(64)
+	atomic_size_t seq;
+	char _seq_padding[64 - sizeof(atomic_size_t)];
+
+	// consumer-local: real seq and copy of its barrier
+	alignas(64)
+	size_t local_seq;
+	size_t cached_barrier;
+	int deps[MCAST_MAX_DEPS];
+	size_t ndeps;
+	bool gating;		// nobody depends on it, the producer waits for it
+} t_mcast_consumer;
+
+typedef struct mcast_ring
+{
+	alignas(64)
+	atomic_size_t cursor;
+	char _cursor_padding[64 - sizeof(atomic_size_t)];
+
+	// producer-local: next sequence to claim, copy of the slowest gate
+	alignas(64)
+	size_t next;
+	size_t cached_gate;
+	char _producer_padding[64 - 2 * sizeof(size_t)];
+
+	t_mcast_consumer	*consumers;
+	size_t	nconsumers;
+	size_t	max_consumers;
+	unsigned char	*buf;
+	size_t	size;		// entries, power of two, all usable
+	size_t	mask;
+	size_t	item_size;
+} t_mcast_ring;
+
+// size in entries, rounded up to a power of two
+t_mcast_ring *mcast_create(size_t size, size_t item_size, size_t max_consumers);
+void mcast_destroy(t_mcast_ring *r);
+
+// setup, before any traffic: returns the consumer id, or -1 if full or a
+// dep isn't an existing consumer. deps may be NULL when ndeps is 0
+int mcast_add_consumer(t_mcast_ring *r, const int *deps, size_t ndeps);
+
+// producer: claim up to n contiguous entries, fill them in place, then
+// commit at most the claimed amount (nothing is visible before commit)
+void *mcast_claim(t_mcast_ring *r, size_t n, size_t *got);
+void mcast_commit(t_mcast_ring *r, size_t n);
+// copy in up to n entries, returns how many fit
+size_t mcast_publish(t_mcast_ring *r, const void *items, size_t n);
+
+// consumer id: up to n contiguous readable entries in place, then
+// release at most that many (entries are invalid after release)
+const void *mcast_peek(t_mcast_ring *r, int id, size_t n, size_t *got);
+void mcast_release(t_mcast_ring *r, int id, size_t n);
+// copy out up to n entries, returns how many
+size_t mcast_consume(t_mcast_ring *r, int id, void *items, size_t n);
+
+#endif
@@ -0,0 +1,144 @@
+#include "spsc_chain.h"
+
+static t_spsc_chain_seg *seg_create(size_t size)
+{
+	t_spsc_chain_seg *seg = malloc(sizeof(t_spsc_chain_seg));
+	if (!seg) return NULL;
+	seg->ring = spsc_create(size);
+	if (!seg->ring)
+		return (free(seg), NULL);
+	atomic_init(&seg->next, NULL);
+	return seg;
+}
+
+static void seg_destroy(t_spsc_chain_seg *seg)
+{
+	if (seg)
+	{
+		spsc_destroy(seg->ring);
+		free(seg);
+	}
+}
+
+t_spsc_chain *spsc_chain_create(size_t seg_size)
+{
+	t_spsc_chain *c = aligned_alloc(64, sizeof(t_spsc_chain));
+	if (!c) return NULL;
+	t_spsc_chain_seg *seg = seg_create(seg_size);
+	if (!seg)
+		return (free(c), NULL);
+	c->tail_seg = seg;
+	c->head_seg = seg;
+	atomic_init(&c->spare, NULL);
+	c->seg_size = seg_size;
+	return c;
+}
+
+void spsc_chain_destroy(t_spsc_chain *c)
+{
+	if (!c)
+		return;
+	t_spsc_chain_seg *seg = c->head_seg;
+	while (seg)
+	{
+		t_spsc_chain_seg *next = atomic_load_explicit(&seg->next, memory_order_relaxed);
+		seg_destroy(seg);
+		seg = next;
+	}
+	seg_destroy(atomic_load_explicit(&c->spare, memory_order_relaxed));
+	free(c);
+}
+
+// producer: the spare if there is one, else a fresh segment
+static t_spsc_chain_seg *next_segment(t_spsc_chain *c)
+{
+	t_spsc_chain_seg *seg = atomic_exchange_explicit(&c->spare, NULL, memory_order_acquire);
+	if (!seg)
+		return seg_create(c->seg_size);
+	// drained, so head == tail and both sides' cached indices agree
+	atomic_store_explicit(&seg->next, NULL, memory_order_relaxed);
+	return seg;
+}
+
+// make seg the producer's segment, its first bytes are already in
+static void link_segment(t_spsc_chain *c, t_spsc_chain_seg *seg)
+{
+	// release: everything pushed into the old segment is visible first
+	atomic_store_explicit(&c->tail_seg->next, seg, memory_order_release);
+	c->tail_seg = seg;
+}
+
+// consumer: keep the newest drained segment as the spare, free the other
+static void retire_segment(t_spsc_chain *c, t_spsc_chain_seg *seg)
+{
+	seg_destroy(atomic_exchange_explicit(&c->spare, seg, memory_order_acq_rel));
+}
+
+// consumer: the current segment is drained and has a successor (the
+// producer is done with it), move on. Callers must look at the ring once
+// more after seeing next: the producer may have pushed after our first try
+static t_spsc_chain_seg *advance(t_spsc_chain *c)
+{
+	t_spsc_chain_seg *seg = c->head_seg;
+	t_spsc_chain_seg *next = atomic_load_explicit(&seg->next, memory_order_acquire);
+	if (!next)
+		return NULL;
+	c->head_seg = next;
+	retire_segment(c, seg);
+	return next;
+}
+
+bool spsc_chain_push_slow(t_spsc_chain *c, unsigned char byte)
+{
+	t_spsc_chain_seg *seg = next_segment(c);
+	if (!seg)
+		return false;
+	spsc_try_push(seg->ring, byte);
+	link_segment(c, seg);
+	return true;
+}
+
+bool spsc_chain_pop_slow(t_spsc_chain *c, unsigned char *byte)
+{
+	if (!atomic_load_explicit(&c->head_seg->next, memory_order_acquire))
+		return false;
+	if (spsc_try_pop(c->head_seg->ring, byte))	// pushed before the link
+		return true;
+	return spsc_try_pop(advance(c)->ring, byte);
+}
+
+size_t spsc_chain_push_batch(t_spsc_chain *c, const void *rawdata, size_t count)
+{
+	const unsigned char *data = rawdata;
+	size_t done = spsc_push_batch(c->tail_seg->ring, data, count);
+	while (done < count)
+	{
+		t_spsc_chain_seg *seg = next_segment(c);
+		if (!seg)
+			break;
+		done += spsc_push_batch(seg->ring, data + done, count - done);
+		link_segment(c, seg);
+	}
+	return done;
+}
+
+size_t spsc_chain_pop_batch(t_spsc_chain *c, void *rawdata, size_t count)
+{
+	unsigned char *data = rawdata;
+	size_t done = 0;
+	while (done < count)
+	{
+		size_t n = spsc_pop_batch(c->head_seg->ring, data + done, count - done);
+		done += n;
+		if (n || done == count)
+			continue;
+		// empty: move on only if the producer has, after one more look
+		if (!atomic_load_explicit(&c->head_seg->next, memory_order_acquire))
+			break;
+		if ((n = spsc_pop_batch(c->head_seg->ring, data + done, count - done)))
+			done += n;
+		else
+			advance(c);
+	}
+	return done;
+}
@@ -0,0 +1,67 @@
+#ifndef SPSC_CHAIN_H
+#define SPSC_CHAIN_H
+
+#include "spsc_ring.h"
+
+/*
+ * Unbounded SPSC byte queue: a linked chain of fixed-size t_spsc_ring
+ * segments. When its segment is full the producer links a new one and
+ * moves on; the consumer drains a segment, follows the link and hands
+ * the old one back. One drained segment is kept as a spare for the next
+ * switch, any other is freed, so memory shrinks back to two segments
+ * once a burst has been consumed.
+ *
+ * The fast paths are inline: a plain spsc_try_push/pop on the current
+ * segment, the chain is only touched when it fails.
+ */
+
+typedef struct spsc_chain_seg
+{
+	t_spsc_ring	*ring;
+	_Atomic(struct spsc_chain_seg *)	next;	// set once, after ring is full
+} t_spsc_chain_seg;
+
+typedef struct spsc_chain
+{
+	// producer-local
+	alignas(64)
+	t_spsc_chain_seg *tail_seg;
+	char _tail_padding[64 - sizeof(t_spsc_chain_seg *)];
+
+	// consumer-local
+	alignas(64)
+	t_spsc_chain_seg *head_seg;
+	char _head_padding[64 - sizeof(t_spsc_chain_seg *)];
+
+	// drained segment waiting for reuse, both sides exchange it
+	alignas(64)
+	_Atomic(t_spsc_chain_seg *) spare;
+	char _spare_padding[64 - sizeof(t_spsc_chain_seg *)];
+
+	size_t	seg_size;
+} t_spsc_chain;
+
+// seg_size in bytes per segment, rounded like spsc_create
+t_spsc_chain *spsc_chain_create(size_t seg_size);
+void spsc_chain_destroy(t_spsc_chain *c);
+
+// slow paths, when the current segment is full / empty
+bool spsc_chain_push_slow(t_spsc_chain *c, unsigned char byte);
+bool spsc_chain_pop_slow(t_spsc_chain *c, unsigned char *byte);
+
+// false only if a new segment couldn't be allocated
+static inline bool spsc_chain_push(t_spsc_chain *c, unsigned char byte)
+{
+	return spsc_try_push(c->tail_seg->ring, byte) || spsc_chain_push_slow(c, byte);
+}
+
+static inline bool spsc_chain_pop(t_spsc_chain *c, unsigned char *byte)
+{
+	return spsc_try_pop(c->head_seg->ring, byte) || spsc_chain_pop_slow(c, byte);
+}
+
+// all count bytes unless allocation fails
+size_t spsc_chain_push_batch(t_spsc_chain *c, const void *rawdata, size_t count);
+size_t spsc_chain_pop_batch(t_spsc_chain *c, void *rawdata, size_t count);
+
+#endif
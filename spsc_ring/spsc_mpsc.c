@@ -0,0 +1,216 @@
+#define _GNU_SOURCE		// syscall
+#include "spsc_mpsc.h"
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
+
+#define SPSC_MPSC_DEFAULT_SPIN	1024
+
+t_spsc_mpsc *spsc_mpsc_create(size_t max_producers, size_t ring_size,
+	size_t item_size, int flags)
+{
+	if (!max_producers || !item_size)
+		return NULL;
+	t_spsc_mpsc *c = aligned_alloc(64, sizeof(t_spsc_mpsc));
+	if (!c) return NULL;
+	c->slots = calloc(max_producers, sizeof(t_spsc_mpsc_slot));
+	if (!c->slots)
+		return (free(c), NULL);
+	for (size_t i = 0; i < max_producers; i++)
+		atomic_init(&c->slots[i].ring, NULL);
+	atomic_init(&c->nslots, 0);
+	atomic_init(&c->consumer_sleeping, 0);
+	atomic_init(&c->wake_seq, 0);
+	c->next = 0;
+	c->quota = 0;
+	c->max_producers = max_producers;
+	// room for at least one item next to the guard byte
+	c->ring_size = ring_size > item_size ? ring_size : item_size + 1;
+	c->item_size = item_size;
+	c->flags = flags;
+	c->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPSC_MPSC_DEFAULT_SPIN : 0;
+	return c;
+}
+
+void spsc_mpsc_destroy(t_spsc_mpsc *c)
+{
+	if (!c)
+		return;
+	for (size_t i = 0; i < c->max_producers; i++)
+		spsc_destroy(atomic_load_explicit(&c->slots[i].ring, memory_order_relaxed));
+	free(c->slots);
+	free(c);
+}
+
+int spsc_mpsc_register(t_spsc_mpsc *c, size_t weight)
+{
+	size_t id = atomic_fetch_add_explicit(&c->nslots, 1, memory_order_relaxed);
+	if (id >= c->max_producers)
+		return -1;
+	t_spsc_ring *r = spsc_create(c->ring_size);
+	if (!r)
+		return -1;		// slot stays empty, the consumer skips it
+	c->slots[id].weight = weight ? weight : 1;
+	// publishes the weight and the ring's initial state to the consumer
+	atomic_store_explicit(&c->slots[id].ring, r, memory_order_release);
+	return (int)id;
+}
+
+// ============== Notification ==============
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__asm__ volatile("pause" ::: "memory");
+#else
+	atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+#ifdef __linux__
+static inline void seq_wait(atomic_uint *seq, unsigned seen)
+{
+	syscall(SYS_futex, (uint32_t *)seq, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+}
+
+static inline void seq_wake(atomic_uint *seq)
+{
+	syscall(SYS_futex, (uint32_t *)seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#else
+static inline void seq_wait(atomic_uint *seq, unsigned seen)
+{
+	(void)seq;
+	(void)seen;
+	sched_yield();
+}
+
+static inline void seq_wake(atomic_uint *seq)
+{
+	(void)seq;
+}
+#endif
+
+// same handshake as the ring's _wait calls: the producer stores its tail
+// then reads the flag, the consumer stores the flag then rescans the rings
+static inline void notify_consumer(t_spsc_mpsc *c)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&c->consumer_sleeping, memory_order_relaxed)
+		&& atomic_exchange_explicit(&c->consumer_sleeping, 0, memory_order_relaxed))
+	{
+		atomic_fetch_add_explicit(&c->wake_seq, 1, memory_order_relaxed);
+		seq_wake(&c->wake_seq);
+	}
+}
+
+// ============== Push / pop ==============
+
+size_t spsc_mpsc_push(t_spsc_mpsc *c, int id, const void *items, size_t n)
+{
+	t_spsc_ring *r = atomic_load_explicit(&c->slots[id].ring, memory_order_relaxed);
+	t_spsc_span first, second;
+	size_t bytes = spsc_write_reserve(r, n * c->item_size, &first, &second);
+	bytes -= bytes % c->item_size;		// whole items only
+	if (!bytes) return 0;
+	size_t head = first.len < bytes ? first.len : bytes;
+	memcpy(first.ptr, items, head);
+	memcpy(second.ptr, (const unsigned char *)items + head, bytes - head);
+	spsc_write_commit(r, bytes);
+	if (c->flags & SPSC_MPSC_NOTIFY)
+		notify_consumer(c);
+	return bytes / c->item_size;
+}
+
+static size_t pop_ring(t_spsc_mpsc *c, t_spsc_ring *r, void *items, size_t n)
+{
+	t_spsc_span first, second;
+	size_t bytes = spsc_read_peek(r, n * c->item_size, &first, &second);
+	bytes -= bytes % c->item_size;
+	if (!bytes) return 0;
+	size_t head = first.len < bytes ? first.len : bytes;
+	memcpy(items, first.ptr, head);
+	memcpy((unsigned char *)items + head, second.ptr, bytes - head);
+	spsc_read_release(r, bytes);
+	return bytes / c->item_size;
+}
+
+size_t spsc_mpsc_pop(t_spsc_mpsc *c, void *items, size_t n, int *from)
+{
+	size_t count = atomic_load_explicit(&c->nslots, memory_order_relaxed);
+	if (count > c->max_producers)
+		count = c->max_producers;
+	if (!n || !count)
+		return 0;
+	for (size_t k = 0; k < count; k++)
+	{
+		size_t i = c->next % count;
+		t_spsc_ring *r = atomic_load_explicit(&c->slots[i].ring, memory_order_acquire);
+		size_t want = n;
+		if (r && (c->flags & SPSC_MPSC_WEIGHTED))
+		{
+			if (!c->quota)
+				c->quota = c->slots[i].weight;
+			if (want > c->quota)
+				want = c->quota;
+		}
+		size_t got = r ? pop_ring(c, r, items, want) : 0;
+		if (got && (c->flags & SPSC_MPSC_WEIGHTED) && (c->quota -= got))
+			c->next = i;		// turn not over, stay on this ring
+		else
+		{
+			c->next = i + 1;
+			c->quota = 0;
+		}
+		if (got)
+		{
+			if (from)
+				*from = (int)i;
+			return got;
+		}
+	}
+	return 0;
+}
+
+size_t spsc_mpsc_pop_wait(t_spsc_mpsc *c, void *items, size_t n, int *from)
+{
+	size_t got;
+	unsigned spins = 0;
+
+	if (!n) return 0;
+	while (!(got = spsc_mpsc_pop(c, items, n, from)))
+	{
+		if (spins++ < c->spin)
+		{
+			cpu_relax();
+			continue;
+		}
+		if (!(c->flags & SPSC_MPSC_NOTIFY))
+		{
+			sched_yield();
+			continue;
+		}
+		// read the sequence first: a wake after this makes FUTEX_WAIT return
+		unsigned seen = atomic_load_explicit(&c->wake_seq, memory_order_acquire);
+		atomic_store_explicit(&c->consumer_sleeping, 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if ((got = spsc_mpsc_pop(c, items, n, from)))
+		{
+			atomic_store_explicit(&c->consumer_sleeping, 0, memory_order_relaxed);
+			break;
+		}
+		seq_wait(&c->wake_seq, seen);
+		atomic_store_explicit(&c->consumer_sleeping, 0, memory_order_relaxed);
+	}
+	return got;
+}
+
+void spsc_mpsc_set_spin(t_spsc_mpsc *c, unsigned spin)
+{
+	c->spin = spin;
+}
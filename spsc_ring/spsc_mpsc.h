@@ -0,0 +1,82 @@
+#ifndef SPSC_MPSC_H
+#define SPSC_MPSC_H
+
+#include "spsc_ring.h"
+
+/*
+ * MPSC fan-in channel: one t_spsc_ring per registered producer, a single
+ * consumer polls them. Producers never share a cache line with each
+ * other, so a push is the plain wait-free ring push. Items are fixed
+ * size and only whole items move, so they are never torn and each one
+ * comes out in its producer's order (no order across producers).
+ *
+ * Polling order:
+ * - round-robin: each pop serves the next non-empty ring
+ * - SPSC_MPSC_WEIGHTED: a ring keeps being served until it has given
+ *   `weight` items in a row (or runs dry), then the next one gets its
+ *   turn. Fewer ring switches, and a busy producer gets a larger share.
+ *
+ * SPSC_MPSC_NOTIFY adds one aggregated "data available" word so
+ * spsc_mpsc_pop_wait can sleep on all rings at once. Producers then pay
+ * a fence and a load per push, and a FUTEX_WAKE only if the consumer
+ * actually sleeps.
+ */
+
+# define SPSC_MPSC_WEIGHTED	1
+# define SPSC_MPSC_NOTIFY	2
+
+typedef struct spsc_mpsc_slot
+{
+	_Atomic(t_spsc_ring *)	ring;	// NULL until its producer registered
+	size_t	weight;		// items per turn, weighted polling
+} t_spsc_mpsc_slot;
+
+typedef struct spsc_mpsc
+{
+	// producers: registration
+	alignas(64)
+	atomic_size_t nslots;
+	char _nslots_padding[64 - sizeof(atomic_size_t)];
+
+	// producers <-> consumer, only touched around a sleep
+	alignas(64)
+	atomic_uint consumer_sleeping;
+	atomic_uint wake_seq;		// futex word, bumped on every wake
+	char _notify_padding[64 - 2 * sizeof(atomic_uint)];
+
+	// consumer-local: ring being served and what is left of its turn
+	alignas(64)
+	size_t next;
+	size_t quota;
+	char _consumer_padding[64 - 2 * sizeof(size_t)];
+
+	t_spsc_mpsc_slot	*slots;
+	size_t	max_producers;
+	size_t	ring_size;		// bytes per producer ring
+	size_t	item_size;
+	int		flags;
+	unsigned	spin;		// pop_wait: retries before sleeping
+} t_spsc_mpsc;
+
+t_spsc_mpsc *spsc_mpsc_create(size_t max_producers, size_t ring_size,
+	size_t item_size, int flags);
+// after all producers are done, frees the rings
+void spsc_mpsc_destroy(t_spsc_mpsc *c);
+
+// producer: claim a ring once, returns the producer id or -1 if all
+// max_producers slots are taken or allocation failed.
+// weight is ignored without SPSC_MPSC_WEIGHTED (0 counts as 1)
+int spsc_mpsc_register(t_spsc_mpsc *c, size_t weight);
+
+// producer id only: push up to n items, returns how many fit
+size_t spsc_mpsc_push(t_spsc_mpsc *c, int id, const void *items, size_t n);
+
+// consumer: pop up to n items from one producer, its id in *from
+// (may be NULL), 0 if every ring looked empty
+size_t spsc_mpsc_pop(t_spsc_mpsc *c, void *items, size_t n, int *from);
+// block until at least one item (sleeps only with SPSC_MPSC_NOTIFY,
+// otherwise keeps yielding)
+size_t spsc_mpsc_pop_wait(t_spsc_mpsc *c, void *items, size_t n, int *from);
+void spsc_mpsc_set_spin(t_spsc_mpsc *c, unsigned spin);
+
+#endif
@@ -1,6 +1,26 @@
+#define _GNU_SOURCE		// memfd_create, shm_open
 #include "spsc_ring.h"
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#ifdef __linux__
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#else
+# include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+#endif
+
+#define SPSC_DEFAULT_SPIN	1024
+#define PREFETCH_BLOCK		4096
 
 // stolen from linux kfifo, roundups to multiples of 64
 static inline size_t to_cache_size(size_t n)
@@ -15,88 +35,854 @@ static inline size_t to_cache_size(size_t n)
 	return n + 1;
 }
 
-t_spsc_ring *spsc_create(size_t size)
+#define SPSC_SHM_MAGIC		0x53505343u		// "SPSC"
+#define HUGE_PAGE_SIZE		(2UL << 20)
+
+static size_t page_size(void)
 {
-	// in c99 is posix_memalign
-	t_spsc_ring	*ring = aligned_alloc(64, sizeof(t_spsc_ring));
-	if (!ring) return NULL;
-	if (size < 2) size = 2;
-	size = to_cache_size(size);
-	ring->buf = aligned_alloc(64, size);
-	if (!ring->buf)
-		return (free(ring), NULL);
+	return sysconf(_SC_PAGESIZE);
+}
+
+static void ring_init(t_spsc_ring *ring, size_t size, size_t buf_offset, int flags)
+{
+	ring->buf_offset = buf_offset;
 	ring->size = size;
 	ring->mask = size - 1;
+	ring->flags = flags;
 	atomic_init(&ring->head, 0);
 	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->claim, 0);
+	ring->cached_head = 0;
+	ring->cached_tail = 0;
+	ring->local_tail = 0;
+	ring->local_head = 0;
+	ring->tail_batch = 1;
+	ring->head_batch = 1;
+	atomic_init(&ring->consumer_sleeping, 0);
+	atomic_init(&ring->producer_sleeping, 0);
+	// spinning can't help if the other side needs our CPU to make progress
+	ring->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPSC_DEFAULT_SPIN : 0;
+	ring->large_copy = SIZE_MAX;		// off, see spsc_set_large_copy
+	ring->prefetch = false;
+	atomic_init(&ring->magic, 0);
+}
+
+#ifdef __linux__
+// header page + buffer, plus the buffer once more if mirrored
+static size_t map_len(size_t hdr, size_t size, int flags)
+{
+	return hdr + size + ((flags & SPSC_F_MIRROR) ? size : 0);
+}
+
+/*
+ * fd holds [header page | buffer]. Reserve the whole range first so the
+ * mirror can go right after the buffer, then map the file over it: the
+ * header and buffer once, the buffer again behind it if mirrored.
+ */
+static t_spsc_ring *map_ring(int fd, size_t hdr, size_t size, int flags)
+{
+	size_t len = map_len(hdr, size, flags);
+	unsigned char *base = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+	if (mmap(base, hdr + size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+		|| ((flags & SPSC_F_MIRROR)
+			&& mmap(base + hdr + size, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_FIXED, fd, hdr) == MAP_FAILED))
+	{
+		munmap(base, len);
+		return NULL;
+	}
+	return (t_spsc_ring *)base;
+}
+
+static t_spsc_ring *mirror_create(size_t size)
+{
+	size_t hdr = page_size();
+	int fd = memfd_create("spsc_ring", MFD_CLOEXEC);
+	if (fd < 0) return NULL;
+	t_spsc_ring *ring = NULL;
+	if (ftruncate(fd, hdr + size) == 0)
+		ring = map_ring(fd, hdr, size, SPSC_F_MIRROR);
+	close(fd);		// the mappings keep it alive
+	if (ring)
+		ring_init(ring, size, hdr, SPSC_F_MIRROR);
+	return ring;
+}
+
+static size_t huge_len(size_t size)
+{
+	return (sizeof(t_spsc_ring) + size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+// same header + buffer block as the heap ring, in 2MB pages if we can get them
+static t_spsc_ring *huge_create(size_t size)
+{
+	size_t len = huge_len(size);
+	int flags = SPSC_F_HUGEPAGE;
+	unsigned char *base = MAP_FAILED;
+# ifdef MAP_HUGETLB
+	base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (base != MAP_FAILED)
+		flags |= SPSC_F_HUGETLB;
+# endif
+	if (base == MAP_FAILED)
+	{
+		// no reserved pages: over-map, trim to a 2MB boundary, ask for THP
+		unsigned char *raw = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED)
+			return NULL;
+		base = (unsigned char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+		if (base > raw)
+			munmap(raw, base - raw);
+		munmap(base + len, raw + HUGE_PAGE_SIZE - base);
+		madvise(base, len, MADV_HUGEPAGE);		// best effort
+	}
+	ring_init((t_spsc_ring *)base, size, sizeof(t_spsc_ring), flags);
+	return (t_spsc_ring *)base;
+}
+#else
+static t_spsc_ring *mirror_create(size_t size)
+{
+	(void)size;
+	return NULL;
+}
+
+static t_spsc_ring *huge_create(size_t size)
+{
+	(void)size;
+	return NULL;
+}
+#endif
+
+t_spsc_ring *spsc_create(size_t size)
+{
+	return spsc_create_ex(size, 0);
+}
+
+t_spsc_ring *spsc_create_ex(size_t size, int flags)
+{
+	if (size < 2) size = 2;
+	size = to_cache_size(size);
+	if (flags & SPSC_F_MIRROR)
+	{
+		size_t page = page_size();
+		t_spsc_ring *ring = mirror_create(size < page ? page : size);	// both powers of two
+		if (ring)
+			return ring;
+	}
+	if (flags & SPSC_F_HUGEPAGE)
+	{
+		t_spsc_ring *ring = huge_create(size);
+		if (ring)
+			return ring;
+	}
+	// header and buffer in one block, sizeof is a multiple of 64
+	// in c99 is posix_memalign
+	t_spsc_ring	*ring = aligned_alloc(64, sizeof(t_spsc_ring) + ((size + 63) & ~(size_t)63));
+	if (!ring) return NULL;
+	ring_init(ring, size, sizeof(t_spsc_ring), 0);
 	return ring;
 }
 
 void spsc_destroy(t_spsc_ring *r)
 {
-	if (r)
+	if (!r)
+		return;
+#ifdef __linux__
+	if (r->flags & (SPSC_F_MIRROR | SPSC_F_SHARED))
+	{
+		munmap(r, map_len(r->buf_offset, r->size, r->flags));
+		return;
+	}
+	if (r->flags & SPSC_F_HUGEPAGE)
+	{
+		munmap(r, huge_len(r->size));
+		return;
+	}
+#endif
+	free(r);
+}
+
+#ifdef __linux__
+t_spsc_ring *spsc_create_shared(const char *name, size_t size)
+{
+	size_t hdr = page_size();
+	if (size < 2) size = 2;
+	size = to_cache_size(size);
+	if (size < hdr) size = hdr;		// mirror needs whole pages
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return NULL;
+	t_spsc_ring *ring = NULL;
+	if (ftruncate(fd, hdr + size) == 0)
+	{
+		int flags = SPSC_F_SHARED | SPSC_F_MIRROR;
+		if (!(ring = map_ring(fd, hdr, size, flags)))
+			ring = map_ring(fd, hdr, size, (flags = SPSC_F_SHARED));
+		if (ring)
+		{
+			ring_init(ring, size, hdr, flags);
+			atomic_store_explicit(&ring->magic, SPSC_SHM_MAGIC, memory_order_release);
+		}
+	}
+	close(fd);
+	if (!ring)
+		shm_unlink(name);
+	return ring;
+}
+
+t_spsc_ring *spsc_attach_shared(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	size_t hdr = page_size();
+	t_spsc_ring *ring = NULL;
+	// peek at the header first to learn size and layout
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size > hdr)
 	{
-		if (r->buf) free(r->buf);
-		free(r);
+		t_spsc_ring *probe = mmap(NULL, hdr, PROT_READ, MAP_SHARED, fd, 0);
+		if (probe != MAP_FAILED)
+		{
+			if (atomic_load_explicit(&probe->magic, memory_order_acquire) == SPSC_SHM_MAGIC
+				&& probe->buf_offset == hdr && hdr + probe->size == (size_t)st.st_size)
+				ring = map_ring(fd, hdr, probe->size, probe->flags);
+			munmap(probe, hdr);
+		}
 	}
+	close(fd);
+	return ring;
+}
+
+int spsc_unlink_shared(const char *name)
+{
+	return shm_unlink(name);
+}
+#else
+t_spsc_ring *spsc_create_shared(const char *name, size_t size)
+{
+	(void)name;
+	(void)size;
+	return NULL;
+}
+
+t_spsc_ring *spsc_attach_shared(const char *name)
+{
+	(void)name;
+	return NULL;
+}
+
+int spsc_unlink_shared(const char *name)
+{
+	(void)name;
+	return -1;
+}
+#endif
+
+// build with -DSPSC_NO_INDEX_CACHE to reload the remote index on every call
+#ifdef SPSC_NO_INDEX_CACHE
+# define ALWAYS_RELOAD 1
+#else
+# define ALWAYS_RELOAD 0
+#endif
+
+// producer side: free cells seen from tail, touches the consumer's
+// line only if the cached head can't satisfy the request
+static inline size_t free_space(t_spsc_ring *r, size_t curr_tail, size_t want)
+{
+	size_t space = r->mask - (curr_tail - r->cached_head);		// 1 cell wasted as guard
+	if (space < want || ALWAYS_RELOAD)
+	{
+		r->cached_head = atomic_load_explicit(&r->head, memory_order_acquire);
+		space = r->mask - (curr_tail - r->cached_head);
+	}
+	return space;
+}
+
+// consumer side: readable cells seen from head, same idea
+static inline size_t used_space(t_spsc_ring *r, size_t curr_head, size_t want)
+{
+	size_t used = r->cached_tail - curr_head;
+	if (used < want || ALWAYS_RELOAD)
+	{
+		r->cached_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+		used = r->cached_tail - curr_head;
+	}
+	return used;
+}
+
+// producer: tail moves privately, the shared one every tail_batch pushes
+static inline void publish_tail(t_spsc_ring *r, size_t new_tail)
+{
+	r->local_tail = new_tail;
+	if (r->tail_batch <= 1
+		|| new_tail - atomic_load_explicit(&r->tail, memory_order_relaxed) >= r->tail_batch)
+		atomic_store_explicit(&r->tail, new_tail, memory_order_release);
+}
+
+// consumer: same, but publish right away if the producer may be stuck
+// (the ring was full as far as it can tell)
+static inline void publish_head(t_spsc_ring *r, size_t new_head)
+{
+	r->local_head = new_head;
+	size_t published = atomic_load_explicit(&r->head, memory_order_relaxed);
+	if (r->head_batch <= 1 || new_head - published >= r->head_batch
+		|| r->cached_tail - published >= r->mask)
+		atomic_store_explicit(&r->head, new_head, memory_order_release);
+}
+
+static inline void flush_tail(t_spsc_ring *r)
+{
+	if (atomic_load_explicit(&r->tail, memory_order_relaxed) != r->local_tail)
+		atomic_store_explicit(&r->tail, r->local_tail, memory_order_release);
+}
+
+static inline void flush_head(t_spsc_ring *r)
+{
+	if (atomic_load_explicit(&r->head, memory_order_relaxed) != r->local_head)
+		atomic_store_explicit(&r->head, r->local_head, memory_order_release);
+}
+
+void spsc_set_lazy(t_spsc_ring *r, size_t consumer_batch, size_t producer_batch)
+{
+	r->head_batch = consumer_batch ? consumer_batch : 1;
+	r->tail_batch = producer_batch ? producer_batch : 1;
+}
+
+void spsc_flush(t_spsc_ring *r)
+{
+	flush_tail(r);
 }
 
 bool spsc_try_push(t_spsc_ring *r, unsigned char byte)
 {
-	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
-	size_t curr_head = atomic_load_explicit(&r->head, memory_order_acquire);
-	if ((curr_tail - curr_head) >= r->mask)
-		return false;		//  buffer full
-	r->buf[curr_tail & r->mask] = byte;
-	atomic_store_explicit(&r->tail, curr_tail + 1, memory_order_release);
+	size_t curr_tail = r->local_tail;
+	if (!free_space(r, curr_tail, 1))
+		return (flush_tail(r), false);		//  buffer full
+	spsc_buf(r)[curr_tail & r->mask] = byte;
+	publish_tail(r, curr_tail + 1);
 	return true;
 }
 
 bool spsc_try_pop(t_spsc_ring *r, unsigned char *byte)
 {
-	size_t curr_head = atomic_load_explicit(&r->head, memory_order_relaxed);
-	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
-	if (curr_head == curr_tail)
-		return false;		// buffer empty
-	(*byte) = r->buf[curr_head & r->mask];
-	atomic_store_explicit(&r->head, curr_head + 1, memory_order_release);
+	size_t curr_head = r->local_head;
+	if (!used_space(r, curr_head, 1))
+		return (flush_head(r), false);		// buffer empty
+	(*byte) = spsc_buf(r)[curr_head & r->mask];
+	publish_head(r, curr_head + 1);
 	return true;
 }
 
+// splits [idx, idx + len) at the end of the buffer
+static inline void ring_spans(t_spsc_ring *r, size_t idx, size_t len,
+	t_spsc_span *first, t_spsc_span *second)
+{
+	size_t off = idx & r->mask;
+	size_t chunk = r->size - off;
+	first->ptr = spsc_buf(r) + off;
+	if (len <= chunk || (r->flags & SPSC_F_MIRROR))
+	{
+		first->len = len;
+		second->ptr = spsc_buf(r);
+		second->len = 0;
+	}
+	else {		// buffer wrap-around
+		first->len = chunk;
+		second->ptr = spsc_buf(r);
+		second->len = len - chunk;
+	}
+}
+
+size_t spsc_write_reserve(t_spsc_ring *r, size_t n, t_spsc_span *first, t_spsc_span *second)
+{
+	size_t curr_tail = r->local_tail;
+	size_t space = free_space(r, curr_tail, n);
+	size_t to_push = (n < space) ? n : space;		// min
+	if (!to_push)
+		flush_tail(r);		// full, let the consumer see everything
+	ring_spans(r, curr_tail, to_push, first, second);
+	return to_push;
+}
+
+void spsc_write_commit(t_spsc_ring *r, size_t n)
+{
+	publish_tail(r, r->local_tail + n);
+}
+
+size_t spsc_read_peek(t_spsc_ring *r, size_t n, t_spsc_span *first, t_spsc_span *second)
+{
+	size_t curr_head = r->local_head;
+	size_t available = used_space(r, curr_head, n);
+	size_t to_pop = (n < available) ? n : available;
+	if (!to_pop)
+		flush_head(r);		// empty, give back everything
+	ring_spans(r, curr_head, to_pop, first, second);
+	return to_pop;
+}
+
+void spsc_read_release(t_spsc_ring *r, size_t n)
+{
+	publish_head(r, r->local_head + n);
+}
+
+// ============== Large copies ==============
+
+#if defined(__x86_64__) || defined(__i386__)
+// unaligned loads, aligned streaming stores, ordinary copies for the edges.
+// The sfence orders the streamed lines before the tail store that publishes
+// them, which a release store alone doesn't do for non-temporal stores.
+__attribute__((target("avx")))
+static void copy_stream_avx(unsigned char *dst, const unsigned char *src, size_t n)
+{
+	size_t head = -(uintptr_t)dst & 31;
+	if (head > n) head = n;
+	memcpy(dst, src, head);
+	dst += head, src += head, n -= head;
+	for (; n >= 128; dst += 128, src += 128, n -= 128)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)src);
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(src + 96));
+		_mm256_stream_si256((__m256i *)dst, a);
+		_mm256_stream_si256((__m256i *)(dst + 32), b);
+		_mm256_stream_si256((__m256i *)(dst + 64), c);
+		_mm256_stream_si256((__m256i *)(dst + 96), d);
+	}
+	memcpy(dst, src, n);
+	_mm_sfence();
+}
+
+__attribute__((target("sse2")))
+static void copy_stream_sse2(unsigned char *dst, const unsigned char *src, size_t n)
+{
+	size_t head = -(uintptr_t)dst & 15;
+	if (head > n) head = n;
+	memcpy(dst, src, head);
+	dst += head, src += head, n -= head;
+	for (; n >= 64; dst += 64, src += 64, n -= 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)src);
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+		__m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+		_mm_stream_si128((__m128i *)dst, a);
+		_mm_stream_si128((__m128i *)(dst + 16), b);
+		_mm_stream_si128((__m128i *)(dst + 32), c);
+		_mm_stream_si128((__m128i *)(dst + 48), d);
+	}
+	memcpy(dst, src, n);
+	_mm_sfence();
+}
+#endif
+
+static void copy_stream(void *dst, const void *src, size_t n)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("avx"))
+		return copy_stream_avx(dst, src, n);
+	if (__builtin_cpu_supports("sse2"))
+		return copy_stream_sse2(dst, src, n);
+#endif
+	memcpy(dst, src, n);
+}
+
+// copy block by block, the next one already on its way
+static void copy_prefetch(void *dst, const void *src, size_t n)
+{
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	while (n)
+	{
+		size_t block = n < PREFETCH_BLOCK ? n : PREFETCH_BLOCK;
+		for (size_t off = block; off < 2 * PREFETCH_BLOCK && off < n; off += 64)
+			__builtin_prefetch(s + off, 0, 0);
+		memcpy(d, s, block);
+		d += block, s += block, n -= block;
+	}
+}
+
+void spsc_set_large_copy(t_spsc_ring *r, size_t threshold, bool prefetch)
+{
+	r->large_copy = threshold;
+	r->prefetch = prefetch;
+}
+
+// batches are reserve/peek + copy + commit/release
 size_t spsc_push_batch(t_spsc_ring *r, const void *rawdata, size_t count)
 {
-	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
-	size_t curr_head = atomic_load_explicit(&r->head, memory_order_acquire);
-	size_t free_space = r->mask - (curr_head - curr_tail);		// 1 cell wasted as guard
-	size_t to_push = (count < free_space) ? count : free_space;		// min
+	t_spsc_span first, second;
+	size_t to_push = spsc_write_reserve(r, count, &first, &second);
 	if (!to_push) return 0;
-	size_t w_idx = r->tail & r->mask;
-	size_t chunk = r->size - w_idx;
-	if (to_push <= chunk)
-		memcpy(r->buf + w_idx, rawdata, to_push);
-	else {		// buffer wrap-around
-		memcpy(r->buf + w_idx, rawdata, chunk);
-		memcpy(r->buf, rawdata + chunk, to_push - chunk);
+	if (to_push >= r->large_copy)
+	{
+		copy_stream(first.ptr, rawdata, first.len);
+		if (second.len)
+			copy_stream(second.ptr, (const unsigned char *)rawdata + first.len, second.len);
 	}
-	atomic_store_explicit(&r->tail, curr_tail + to_push, memory_order_release);
+	else
+	{
+		memcpy(first.ptr, rawdata, first.len);
+		if (second.len)
+			memcpy(second.ptr, (const unsigned char *)rawdata + first.len, second.len);
+	}
+	spsc_write_commit(r, to_push);
 	return to_push;
 }
 
 size_t spsc_pop_batch(t_spsc_ring *r, void *rawdata, size_t count)
 {
-	size_t curr_head = atomic_load_explicit(&r->head, memory_order_relaxed);
-	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
-	size_t available = curr_tail - curr_head;
-	size_t to_pop = (count < available) ? count : available;
+	t_spsc_span first, second;
+	size_t to_pop = spsc_read_peek(r, count, &first, &second);
 	if (!to_pop) return 0;
-	size_t r_idx = r->head & r->mask;
-	size_t chunk = r->size - r_idx;
-	if (to_pop <= chunk)
-		memcpy(rawdata, r->buf + r_idx, to_pop);
-	else {
-		memcpy(rawdata, r->buf + r_idx, chunk);
-		memcpy(rawdata + chunk, r->buf, to_pop - chunk);
-	}
-	atomic_store_explicit(&r->head, curr_head + to_pop, memory_order_release);
+	if (r->prefetch && to_pop >= r->large_copy)
+	{
+		copy_prefetch(rawdata, first.ptr, first.len);
+		if (second.len)
+			copy_prefetch((unsigned char *)rawdata + first.len, second.ptr, second.len);
+	}
+	else
+	{
+		memcpy(rawdata, first.ptr, first.len);
+		if (second.len)
+			memcpy((unsigned char *)rawdata + first.len, second.ptr, second.len);
+	}
+	spsc_read_release(r, to_pop);
 	return to_pop;
 }
+
+// ============== fd I/O ==============
+
+// splice/vmsplice don't fit: one end must be a pipe, and vmsplice'd ring
+// pages would still be referenced by the pipe after we release them
+
+static inline int span_iov(const t_spsc_span *first, const t_spsc_span *second,
+	struct iovec iov[2])
+{
+	iov[0] = (struct iovec){first->ptr, first->len};
+	iov[1] = (struct iovec){second->ptr, second->len};
+	return second->len ? 2 : 1;
+}
+
+ssize_t spsc_push_from_fd(t_spsc_ring *r, int fd, size_t max)
+{
+	t_spsc_span first, second;
+	struct iovec iov[2];
+
+	if (!max) return 0;
+	if (!spsc_write_reserve(r, max, &first, &second))
+		return (errno = ENOBUFS, -1);
+	ssize_t n = readv(fd, iov, span_iov(&first, &second, iov));
+	if (n > 0)
+		spsc_write_commit(r, n);
+	return n;
+}
+
+ssize_t spsc_pop_to_fd(t_spsc_ring *r, int fd, size_t max)
+{
+	t_spsc_span first, second;
+	struct iovec iov[2];
+
+	if (!spsc_read_peek(r, max, &first, &second))
+		return 0;
+	ssize_t n = writev(fd, iov, span_iov(&first, &second, iov));
+	if (n > 0)
+		spsc_read_release(r, n);
+	return n;
+}
+
+// ============== Overwrite mode ==============
+
+void spsc_push_overwrite(t_spsc_ring *r, const void *rawdata, size_t count)
+{
+	size_t curr_tail = r->local_tail;
+	size_t skip = count > r->mask ? count - r->mask : 0;	// overwritten anyway
+	t_spsc_span first, second;
+
+	atomic_store_explicit(&r->claim, curr_tail + count, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);		// claim before the data
+	ring_spans(r, curr_tail + skip, count - skip, &first, &second);
+	memcpy(first.ptr, (const unsigned char *)rawdata + skip, first.len);
+	memcpy(second.ptr, (const unsigned char *)rawdata + skip + first.len, second.len);
+	r->local_tail = curr_tail + count;
+	atomic_store_explicit(&r->tail, r->local_tail, memory_order_release);
+}
+
+size_t spsc_pop_lossy(t_spsc_ring *r, void *rawdata, size_t count, size_t *lost)
+{
+	size_t curr_head = r->local_head;
+	size_t n = 0;
+	t_spsc_span first, second;
+
+	*lost = 0;
+	while (count)
+	{
+		size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+		if (tail - curr_head > r->mask)		// lapped: skip to the oldest kept byte
+		{
+			*lost += tail - r->mask - curr_head;
+			curr_head = tail - r->mask;
+		}
+		n = tail - curr_head < count ? tail - curr_head : count;
+		if (!n)
+			break;
+		ring_spans(r, curr_head, n, &first, &second);
+		memcpy(rawdata, first.ptr, first.len);
+		memcpy((unsigned char *)rawdata + first.len, second.ptr, second.len);
+		atomic_thread_fence(memory_order_acquire);	// data before the recheck
+		// bytes below claim - size may have been rewritten during the copy
+		size_t claim = atomic_load_explicit(&r->claim, memory_order_relaxed);
+		size_t torn = claim - curr_head > r->size ? claim - r->size - curr_head : 0;
+		if (torn < n)
+		{
+			memmove(rawdata, (unsigned char *)rawdata + torn, n - torn);
+			*lost += torn;
+			curr_head += n;
+			n -= torn;
+			break;
+		}
+		*lost += torn;		// all of it, try again from there
+		curr_head += torn;
+		n = 0;
+	}
+	r->local_head = curr_head;
+	atomic_store_explicit(&r->head, curr_head, memory_order_release);
+	return n;
+}
+
+// ============== Blocking waits ==============
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__asm__ volatile("pause" ::: "memory");
+#else
+	atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+// futex words are 32 bits: wait on the low half of the index, it can't
+// wrap 2^32 while one side sleeps since the other blocks after size bytes.
+// Not FUTEX_PRIVATE, so rings in shared memory work across processes.
+static inline uint32_t *index_word(atomic_size_t *idx)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return (uint32_t *)idx + (sizeof(size_t) / sizeof(uint32_t) - 1);
+#else
+	return (uint32_t *)idx;
+#endif
+}
+
+#ifdef __linux__
+static inline void index_wait(atomic_size_t *idx, size_t seen)
+{
+	syscall(SYS_futex, index_word(idx), FUTEX_WAIT, (uint32_t)seen, NULL, NULL, 0);
+}
+
+static inline void index_wake(atomic_size_t *idx)
+{
+	syscall(SYS_futex, index_word(idx), FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+#else
+static inline void index_wait(atomic_size_t *idx, size_t seen)
+{
+	(void)idx;
+	(void)seen;
+	sched_yield();
+}
+
+static inline void index_wake(atomic_size_t *idx)
+{
+	(void)idx;
+}
+#endif
+
+/*
+ * Dekker-style handshake: the sleeper stores its flag then reads the
+ * index, the waker stores the index then reads the flag, each with a
+ * full fence in between. At least one of them sees the other's store,
+ * and FUTEX_WAIT rechecks the index in the kernel for the gap between
+ * the load and the sleep. The waker clears the flag, so a sleeper that
+ * hasn't run yet costs one FUTEX_WAKE, not one per batch.
+ */
+static void sleep_on(atomic_size_t *idx, atomic_uint *flag, size_t seen)
+{
+	atomic_store_explicit(flag, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(idx, memory_order_relaxed) == seen)
+		index_wait(idx, seen);
+	atomic_store_explicit(flag, 0, memory_order_relaxed);
+}
+
+static inline void wake_if_sleeping(atomic_size_t *idx, atomic_uint *flag)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(flag, memory_order_relaxed)
+		&& atomic_exchange_explicit(flag, 0, memory_order_relaxed))
+		index_wake(idx);
+}
+
+void spsc_set_spin(t_spsc_ring *r, unsigned spin)
+{
+	r->spin = spin;
+}
+
+size_t spsc_push_batch_wait(t_spsc_ring *r, const void *rawdata, size_t count)
+{
+	size_t n;
+	unsigned spins = 0;
+
+	if (!count) return 0;
+	while (!(n = spsc_push_batch(r, rawdata, count)))
+	{
+		if (spins++ < r->spin)
+		{
+			cpu_relax();
+			continue;
+		}
+		// full: sleep until head moves past what made it full
+		sleep_on(&r->head, &r->producer_sleeping, r->local_tail - r->mask);
+	}
+	flush_tail(r);
+	wake_if_sleeping(&r->tail, &r->consumer_sleeping);
+	return n;
+}
+
+size_t spsc_pop_batch_wait(t_spsc_ring *r, void *rawdata, size_t count)
+{
+	size_t n;
+	unsigned spins = 0;
+
+	if (!count) return 0;
+	while (!(n = spsc_pop_batch(r, rawdata, count)))
+	{
+		if (spins++ < r->spin)
+		{
+			cpu_relax();
+			continue;
+		}
+		// empty: sleep until tail moves past head
+		sleep_on(&r->tail, &r->consumer_sleeping, r->local_head);
+	}
+	flush_head(r);
+	wake_if_sleeping(&r->head, &r->producer_sleeping);
+	return n;
+}
+
+void spsc_push_wait(t_spsc_ring *r, unsigned char byte)
+{
+	spsc_push_batch_wait(r, &byte, 1);
+}
+
+unsigned char spsc_pop_wait(t_spsc_ring *r)
+{
+	unsigned char byte;
+	spsc_pop_batch_wait(r, &byte, 1);
+	return byte;
+}
+
+// ============== Framed messages ==============
+
+#define MSG_HDR		8				// uint32_t len + 4B reserved, keeps payloads 8B aligned
+#define MSG_PAD		UINT32_MAX		// skip to the start of the buffer
+#define MSG_LEN_MAX	(MSG_PAD - 1)	// what the 32-bit length can say
+
+static inline size_t msg_record(size_t len)
+{
+	return MSG_HDR + ((len + 7) & ~(size_t)7);
+}
+
+static inline uint32_t *msg_hdr(t_spsc_ring *r, size_t idx)
+{
+	return (uint32_t *)(spsc_buf(r) + (idx & r->mask));
+}
+
+// half the ring: enough to fit after a skip marker wherever tail is.
+// Rings of 4 GiB and up are capped by the header's length field
+size_t spsc_msg_max(const t_spsc_ring *r)
+{
+	size_t max;
+	if (r->flags & SPSC_F_MIRROR)
+		max = r->size - 2 * MSG_HDR;	// never skips, just 8B free + header
+	else if (r->size / 2 < 2 * MSG_HDR)
+		return 0;
+	else
+		max = r->size / 2 - MSG_HDR;
+	return max < MSG_LEN_MAX ? max : MSG_LEN_MAX;
+}
+
+// space needed at tail for a record, including the skip marker if any
+static inline size_t msg_needed(t_spsc_ring *r, size_t curr_tail, size_t record)
+{
+	size_t off = curr_tail & r->mask;
+	if (off + record <= r->size || (r->flags & SPSC_F_MIRROR))
+		return record;
+	return (r->size - off) + record;
+}
+
+void *spsc_msg_reserve(t_spsc_ring *r, size_t len)
+{
+	if (len > spsc_msg_max(r))
+		return NULL;
+	size_t curr_tail = r->local_tail;
+	size_t record = msg_record(len);
+	size_t needed = msg_needed(r, curr_tail, record);
+	if (free_space(r, curr_tail, needed) < needed)
+		return (flush_tail(r), NULL);
+	// commit reads back the header to know if a skip was written
+	if (needed != record)
+	{
+		*msg_hdr(r, curr_tail) = MSG_PAD;
+		curr_tail += needed - record;
+	}
+	*msg_hdr(r, curr_tail) = (uint32_t)len;
+	return spsc_buf(r) + (curr_tail & r->mask) + MSG_HDR;
+}
+
+void spsc_msg_commit(t_spsc_ring *r, size_t len)
+{
+	size_t curr_tail = r->local_tail;
+	size_t start = curr_tail;
+	if (*msg_hdr(r, curr_tail) == MSG_PAD)
+		start += r->size - (curr_tail & r->mask);
+	*msg_hdr(r, start) = (uint32_t)len;
+	// skip marker and record become visible together
+	publish_tail(r, start + msg_record(len));
+}
+
+bool spsc_send_msg(t_spsc_ring *r, const void *msg, size_t len)
+{
+	void *dst = spsc_msg_reserve(r, len);
+	if (!dst) return false;
+	memcpy(dst, msg, len);
+	spsc_msg_commit(r, len);
+	return true;
+}
+
+const void *spsc_recv_msg(t_spsc_ring *r, size_t *len)
+{
+	size_t curr_head = r->local_head;
+	if (used_space(r, curr_head, MSG_HDR) < MSG_HDR)
+		return (flush_head(r), NULL);		// empty
+	uint32_t hdr = *msg_hdr(r, curr_head);
+	if (hdr == MSG_PAD)
+	{
+		// release the skip right away, the record behind it is already published
+		curr_head += r->size - (curr_head & r->mask);
+		publish_head(r, curr_head);
+		hdr = *msg_hdr(r, curr_head);
+	}
+	*len = hdr;
+	return spsc_buf(r) + (curr_head & r->mask) + MSG_HDR;
+}
+
+void spsc_msg_release(t_spsc_ring *r)
+{
+	size_t curr_head = r->local_head;
+	size_t len = *msg_hdr(r, curr_head);
+	publish_head(r, curr_head + msg_record(len));
+}
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdalign.h>
 #include <stdatomic.h>
+#include <sys/types.h>
 
 // head and tail aligned as 64B 
 // to take a full cache line and avoid false sharing
@@ -14,25 +15,185 @@ struct spsc_ring
 	atomic_size_t head;
 	char _head_padding[64 - sizeof(atomic_size_t)];
 
+	// overwrite mode: claim is where the producer is writing up to,
+	// stored before the data (seqlock style), on the same line as tail
 	alignas(64)
 	atomic_size_t tail;
-	char _tail_padding[64 - sizeof(atomic_size_t)];
+	atomic_size_t claim;
+	char _tail_padding[64 - 2 * sizeof(atomic_size_t)];
 
-	unsigned char	*buf;
+	// producer-local: copy of head, reloaded only when the ring looks full,
+	// real tail and how many pushes to batch before publishing it
+	alignas(64)
+	size_t cached_head;
+	size_t local_tail;
+	size_t tail_batch;
+	char _producer_padding[64 - 3 * sizeof(size_t)];
+
+	// consumer-local: copy of tail, reloaded only when the ring looks empty,
+	// real head and how many pops to batch before publishing it
+	alignas(64)
+	size_t cached_tail;
+	size_t local_head;
+	size_t head_batch;
+	char _consumer_padding[64 - 3 * sizeof(size_t)];
+
+	// set while a _wait call sleeps on tail (consumer) / head (producer)
+	alignas(64)
+	atomic_uint consumer_sleeping;
+	char _consumer_sleeping_padding[64 - sizeof(atomic_uint)];
+
+	alignas(64)
+	atomic_uint producer_sleeping;
+	char _producer_sleeping_padding[64 - sizeof(atomic_uint)];
+
+	// buffer at (char *)ring + buf_offset, in the same allocation or
+	// mapping, so the header works at any address (shared memory)
+	size_t	buf_offset;
 	size_t	size;		// physical
 	size_t	mask;		// logical size + mask for fast modulo
+	int		flags;		// what the ring actually got, see spsc_create_ex
+	size_t	large_copy;	// batches from this size up: streaming stores / prefetch
+	bool	prefetch;
+	unsigned	spin;		// _wait calls: retries before sleeping
+	atomic_uint	magic;		// shared rings: set last by the creator
 };
 
 // Minimal API
 typedef struct spsc_ring t_spsc_ring;
 
+// buffer mapped twice back to back (Linux memfd): buf[i] and buf[i + size]
+// are the same byte, so any window of up to size bytes is contiguous.
+// size is rounded up to a page. Falls back to a plain buffer if the
+// mapping fails; check r->flags.
+# define SPSC_F_MIRROR	1
+# define SPSC_F_SHARED	2		// set by spsc_create/attach_shared
+// header + buffer in 2MB pages for large rings: MAP_HUGETLB if the pool
+// has pages (then SPSC_F_HUGETLB is set too), else a 2MB-aligned mapping
+// advised MADV_HUGEPAGE. Ignored when SPSC_F_MIRROR succeeds.
+# define SPSC_F_HUGEPAGE	4
+# define SPSC_F_HUGETLB	8
+
+static inline unsigned char *spsc_buf(const t_spsc_ring *r)
+{
+	return (unsigned char *)r + r->buf_offset;
+}
+
 t_spsc_ring *spsc_create(size_t size);
+t_spsc_ring *spsc_create_ex(size_t size, int flags);
+// heap rings are freed, mapped ones unmapped (shared names stay)
 void spsc_destroy(t_spsc_ring *r);
 
+// Cross-process rings: header and buffer live in a POSIX shm object
+// (mirrored when possible), one process creates, the other attaches by
+// name. Blocking calls work across processes. Attach returns NULL until
+// the creator is done initializing.
+t_spsc_ring *spsc_create_shared(const char *name, size_t size);
+t_spsc_ring *spsc_attach_shared(const char *name);
+int spsc_unlink_shared(const char *name);
+
 bool spsc_try_push(t_spsc_ring *r, unsigned char byte);
 bool spsc_try_pop(t_spsc_ring *r, unsigned char *byte);
 
 size_t spsc_push_batch(t_spsc_ring *r, const void *rawdata, size_t count);
 size_t spsc_pop_batch(t_spsc_ring *r, void *rawdata, size_t count);
 
+// Large batches
+// push_batch copies from `threshold` bytes up with non-temporal stores
+// (AVX or SSE2, picked at run time; plain memcpy elsewhere), so a big
+// batch doesn't evict the producer's cache only to be read from memory
+// by the other core anyway. With prefetch, pop_batch of that size also
+// prefetches a few KB ahead of its copy. Off by default (SIZE_MAX):
+// it only pays off when the consumer runs on another core and batches
+// outgrow the producer's cache, benchmark_large_copy shows where.
+// Set before use.
+void spsc_set_large_copy(t_spsc_ring *r, size_t threshold, bool prefetch);
+
+// Lazy publication
+// publish head once it is consumer_batch bytes ahead of the shared copy,
+// tail once it is producer_batch bytes ahead, instead of on every call
+// (1 = eager, the default), so single-byte workloads don't bounce the
+// index lines each time. The consumer also
+// publishes when it finds the ring empty or when the producer may be
+// stuck on a full ring; the producer when the ring is full. Anything else
+// the producer wrote stays invisible until spsc_flush. Set before use.
+void spsc_set_lazy(t_spsc_ring *r, size_t consumer_batch, size_t producer_batch);
+void spsc_flush(t_spsc_ring *r);
+
+// fd I/O
+// one readv/writev straight on the (one or two) spans of the buffer,
+// no bounce buffer. Return what read/write returned: bytes moved, 0 on
+// EOF (push) or if the ring is empty (pop), -1 with errno set. A push on
+// a full ring is -1 with ENOBUFS.
+ssize_t spsc_push_from_fd(t_spsc_ring *r, int fd, size_t max);
+ssize_t spsc_pop_to_fd(t_spsc_ring *r, int fd, size_t max);
+
+// Overwrite mode (telemetry): the producer never waits, a full ring
+// loses its oldest bytes instead. The consumer detects it by re-reading
+// the producer's claim after copying: whatever may have been rewritten
+// meanwhile is dropped and added to *lost along with what was already
+// gone. Only use these two calls on such a ring (no lazy publication);
+// reads race with writes by design and are validated after the copy.
+
+// writes all count bytes; past capacity only the last ones survive
+void spsc_push_overwrite(t_spsc_ring *r, const void *rawdata, size_t count);
+// up to count intact bytes, oldest first; *lost = bytes skipped this call
+size_t spsc_pop_lossy(t_spsc_ring *r, void *rawdata, size_t count, size_t *lost);
+
+// Blocking API
+// spin up to r->spin retries (default 1024, 0 on a single CPU),
+// then FUTEX_WAIT on the other side's index.
+// A side only wakes its peer (one syscall) if the peer's sleeping flag
+// is set, so busy rings never enter the kernel. They always publish. A side that may sleep
+// relies on the other one using the _wait calls too: plain try/batch
+// calls never wake anybody.
+void spsc_set_spin(t_spsc_ring *r, unsigned spin);
+
+void spsc_push_wait(t_spsc_ring *r, unsigned char byte);
+unsigned char spsc_pop_wait(t_spsc_ring *r);
+
+// block until at least 1 byte moved, return how many (0 only if count is 0)
+size_t spsc_push_batch_wait(t_spsc_ring *r, const void *rawdata, size_t count);
+size_t spsc_pop_batch_wait(t_spsc_ring *r, void *rawdata, size_t count);
+
+// Zero-copy API
+// a region of the ring is one or two spans (second is empty unless it wraps,
+// never on a mirrored ring)
+typedef struct spsc_span
+{
+	unsigned char	*ptr;
+	size_t	len;
+} t_spsc_span;
+
+// producer: reserve up to n free bytes, fill them in place, then commit
+// at most the reserved amount (nothing is visible before commit)
+size_t spsc_write_reserve(t_spsc_ring *r, size_t n, t_spsc_span *first, t_spsc_span *second);
+void spsc_write_commit(t_spsc_ring *r, size_t n);
+
+// consumer: peek up to n readable bytes in place, then release
+// at most the peeked amount (spans are invalid after release)
+size_t spsc_read_peek(t_spsc_ring *r, size_t n, t_spsc_span *first, t_spsc_span *second);
+void spsc_read_release(t_spsc_ring *r, size_t n);
+
+// Framed messages
+// records are an 8B length header + payload padded to 8B, never split:
+// when one doesn't fit before the end of the buffer a skip marker fills
+// the rest and it starts again at offset 0 (BipBuffer style).
+// Mirrored rings need no skip.
+// Don't mix with the byte API on the same ring.
+
+// largest payload that is guaranteed to fit in an empty ring, at most
+// UINT32_MAX - 1 (32-bit length header)
+size_t spsc_msg_max(const t_spsc_ring *r);
+
+// producer: false/NULL if there's no room (or len > spsc_msg_max)
+bool spsc_send_msg(t_spsc_ring *r, const void *msg, size_t len);
+void *spsc_msg_reserve(t_spsc_ring *r, size_t len);
+void spsc_msg_commit(t_spsc_ring *r, size_t len);	// len <= reserved
+
+// consumer: contiguous view of the next message, NULL if empty;
+// valid until spsc_msg_release
+const void *spsc_recv_msg(t_spsc_ring *r, size_t *len);
+void spsc_msg_release(t_spsc_ring *r);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+#ifndef SPSC_TYPED_H
+#define SPSC_TYPED_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+/*
+ * Typed SPSC ring, generated per element type:
+ *
+ *   SPSC_RING_DEFINE(rec_ring, t_record)
+ *
+ * defines t_rec_ring and rec_ring_create/destroy/try_push/try_pop/
+ * push_batch/pop_batch. Same layout and protocol as t_spsc_ring
+ * (padded indices, cached remote index, one guard slot) but indices
+ * count whole elements, so a record can never be torn, and
+ * sizeof(T) is a compile-time constant in every copy.
+ * Everything is static inline: use it in as many units as needed.
+ */
+
+static inline size_t spsc_typed_roundup(size_t n)
+{
+	n--;
+	n |= n >> 1;
+	n |= n >> 2;
+	n |= n >> 4;
+	n |= n >> 8;
+	n |= n >> 16;
+	n |= n >> 32;
+	return n + 1;
+}
+
+#define SPSC_RING_DEFINE(name, T) \
+\
+typedef struct name \
+{ \
+	alignas(64) \
+	atomic_size_t head; \
+	char _head_padding[64 - sizeof(atomic_size_t)]; \
+\
+	alignas(64) \
+	atomic_size_t tail; \
+	char _tail_padding[64 - sizeof(atomic_size_t)]; \
+\
+	alignas(64) \
+	size_t cached_head; \
+	char _cached_head_padding[64 - sizeof(size_t)]; \
+\
+	alignas(64) \
+	size_t cached_tail; \
+	char _cached_tail_padding[64 - sizeof(size_t)]; \
+\
+	T		*buf; \
+	size_t	size;		/* slots, physical */ \
+	size_t	mask; \
+} t_##name; \
+\
+/* size in elements, rounded up to a power of two, capacity is size - 1 */ \
+static inline t_##name *name##_create(size_t size) \
+{ \
+	t_##name *ring = aligned_alloc(64, sizeof(t_##name)); \
+	if (!ring) return NULL; \
+	if (size < 2) size = 2; \
+	size = spsc_typed_roundup(size); \
+	ring->buf = aligned_alloc(64, ((size * sizeof(T) + 63) & ~(size_t)63)); \
+	if (!ring->buf) \
+		return (free(ring), NULL); \
+	ring->size = size; \
+	ring->mask = size - 1; \
+	atomic_init(&ring->head, 0); \
+	atomic_init(&ring->tail, 0); \
+	ring->cached_head = 0; \
+	ring->cached_tail = 0; \
+	return ring; \
+} \
+\
+static inline void name##_destroy(t_##name *r) \
+{ \
+	if (r) \
+	{ \
+		free(r->buf); \
+		free(r); \
+	} \
+} \
+\
+static inline size_t name##_free_space(t_##name *r, size_t curr_tail, size_t want) \
+{ \
+	size_t space = r->mask - (curr_tail - r->cached_head); \
+	if (space < want) \
+	{ \
+		r->cached_head = atomic_load_explicit(&r->head, memory_order_acquire); \
+		space = r->mask - (curr_tail - r->cached_head); \
+	} \
+	return space; \
+} \
+\
+static inline size_t name##_used_space(t_##name *r, size_t curr_head, size_t want) \
+{ \
+	size_t used = r->cached_tail - curr_head; \
+	if (used < want) \
+	{ \
+		r->cached_tail = atomic_load_explicit(&r->tail, memory_order_acquire); \
+		used = r->cached_tail - curr_head; \
+	} \
+	return used; \
+} \
+\
+static inline bool name##_try_push(t_##name *r, const T *item) \
+{ \
+	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_relaxed); \
+	if (!name##_free_space(r, curr_tail, 1)) \
+		return false; \
+	r->buf[curr_tail & r->mask] = *item; \
+	atomic_store_explicit(&r->tail, curr_tail + 1, memory_order_release); \
+	return true; \
+} \
+\
+static inline bool name##_try_pop(t_##name *r, T *item) \
+{ \
+	size_t curr_head = atomic_load_explicit(&r->head, memory_order_relaxed); \
+	if (!name##_used_space(r, curr_head, 1)) \
+		return false; \
+	*item = r->buf[curr_head & r->mask]; \
+	atomic_store_explicit(&r->head, curr_head + 1, memory_order_release); \
+	return true; \
+} \
+\
+/* counts are in elements, returns how many whole elements moved */ \
+static inline size_t name##_push_batch(t_##name *r, const T *items, size_t count) \
+{ \
+	size_t curr_tail = atomic_load_explicit(&r->tail, memory_order_relaxed); \
+	size_t space = name##_free_space(r, curr_tail, count); \
+	size_t to_push = (count < space) ? count : space; \
+	if (!to_push) return 0; \
+	size_t w_idx = curr_tail & r->mask; \
+	size_t chunk = r->size - w_idx; \
+	if (to_push <= chunk) \
+		memcpy(r->buf + w_idx, items, to_push * sizeof(T)); \
+	else { \
+		memcpy(r->buf + w_idx, items, chunk * sizeof(T)); \
+		memcpy(r->buf, items + chunk, (to_push - chunk) * sizeof(T)); \
+	} \
+	atomic_store_explicit(&r->tail, curr_tail + to_push, memory_order_release); \
+	return to_push; \
+} \
+\
+static inline size_t name##_pop_batch(t_##name *r, T *items, size_t count) \
+{ \
+	size_t curr_head = atomic_load_explicit(&r->head, memory_order_relaxed); \
+	size_t available = name##_used_space(r, curr_head, count); \
+	size_t to_pop = (count < available) ? count : available; \
+	if (!to_pop) return 0; \
+	size_t r_idx = curr_head & r->mask; \
+	size_t chunk = r->size - r_idx; \
+	if (to_pop <= chunk) \
+		memcpy(items, r->buf + r_idx, to_pop * sizeof(T)); \
+	else { \
+		memcpy(items, r->buf + r_idx, chunk * sizeof(T)); \
+		memcpy(items + chunk, r->buf, (to_pop - chunk) * sizeof(T)); \
+	} \
+	atomic_store_explicit(&r->head, curr_head + to_pop, memory_order_release); \
+	return to_pop; \
+}
+
+#endif